@@ -0,0 +1,51 @@
+/*
+*   This example measures time spent by the library:
+*   -   interrupt work (framing of received byte, resync on gap)
+*   -   process() for each command class (function group, speed, CV verify, CV bit manipulation, broadcast)
+*   Result is printed in machine readable form (CSV), one line per case:
+*       bench,<name>,<count>,<min>,<avg>,<max>
+*   values are in SysTick ticks, line "meta,tick_hz,..." tells tick frequency (ticks * core_hz / tick_hz = cycles).
+*   Save the output for each release and compare it, then regressions are visible.
+*
+*   Note: run it with SUSI bus disconnected, bytes from master would be mixed to measured packets.
+*/
+
+#include <SUSI2.h>        // Include the library for SUSI management
+
+SUSI2 SUSI;            // new version does not needed pin definition, as it use hardware receiver on PC5 and PC6 pins.
+
+#define BENCH_NOW()     (SysTick->CNT)                                      // SysTick is 32 bit up counter, runs already for millis()
+#define BENCH_LOCK()    noInterrupts()
+#define BENCH_UNLOCK()  interrupts()
+
+void benchReport(const char* Name, uint32_t Count, uint32_t Min, uint32_t Avg, uint32_t Max) {
+    Serial.print("bench,");
+    Serial.print(Name);
+    Serial.print(",");
+    Serial.print(Count);
+    Serial.print(",");
+    Serial.print(Min);
+    Serial.print(",");
+    Serial.print(Avg);
+    Serial.print(",");
+    Serial.println(Max);
+}
+
+#include "SusiBench.h"    // benchmark cases, shared with host build
+
+void setup() {                                                                                                      // Setup Code
+    Serial.begin(115200);
+    SUSI.init();                                                                                                    // Start the library
+    delay(100);
+
+    Serial.println("meta,target,CH32V003");
+    Serial.print("meta,core_hz,");
+    Serial.println(SystemCoreClock);
+    Serial.print("meta,tick_hz,");
+    Serial.println((SysTick->CTLR & 0x04) ? SystemCoreClock : SystemCoreClock / 8);  // STCLK bit: HCLK or HCLK/8
+    benchRun();
+    Serial.println("done");
+}
+
+void loop() {                                                                                                       // Code loop
+}
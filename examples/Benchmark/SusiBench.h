@@ -0,0 +1,157 @@
+/*
+*   Benchmark cases shared by Benchmark.ino (target) and extras/host/bench.cpp (host build).
+*
+*   Includer must provide:
+*   -   BENCH_NOW()                 free running counter (uint32_t), SysTick on target, rdtsc on host
+*   -   BENCH_LOCK() BENCH_UNLOCK() disable / enable interrupts around one measurement
+*   -   benchReport(Name, Count, Min, Avg, Max)   output of one result line
+*   -   SUSI2 object named SUSI, already initialized
+*
+*   Every case is measured BENCH_LOOPS times, the cost of BENCH_NOW() itself is subtracted.
+*   Interrupt handlers can not be called directly (they return by mret), then their bodies are measured:
+*   isr_* cases are framing (ReceiveByte) and resync (ResetReceiver) - exactly what SPI1 and TIM1 interrupts do,
+*   without interrupt entry / exit.
+*/
+
+#ifndef SUSI_BENCH_H
+#define SUSI_BENCH_H
+
+#include <SUSI2.h>
+
+#ifndef BENCH_LOOPS
+#define BENCH_LOOPS 256
+#endif
+
+/* callbacks - minimal work, but they exist, then all decoding paths are taken */
+static volatile uint8_t BenchSink;                                            // to not be optimized out
+static uint8_t BenchCVs[128];                                                 // CVs in RAM
+
+void notifySusiFunc(SUSI_FN_GROUP SUSI_FuncGrp, uint8_t SUSI_FuncState) {BenchSink = SUSI_FuncGrp ^ SUSI_FuncState;}
+void notifySusiRealSpeed(uint8_t Speed, SUSI_DIRECTION Dir) {BenchSink = Speed ^ Dir;}
+void notifySusiBinaryState(uint8_t Command, uint8_t CommandState) {BenchSink = Command ^ CommandState;}
+uint8_t notifySusiCVRead(uint8_t CV, uint8_t /*CVindex*/) {return BenchCVs[CV & 0x7F];}
+uint8_t notifySusiCVWrite(uint8_t CV, uint8_t /*CVindex*/, uint8_t Value) {BenchCVs[CV & 0x7F] = Value; return Value;}
+
+/* the same callbacks bound statically - process(BenchStatic) */
+class BenchCallbacks : public SusiCallbacks<BenchCallbacks> {
+  public:
+    void notifySusiFunc(SUSI_FN_GROUP SUSI_FuncGrp, uint8_t SUSI_FuncState) {BenchSink = SUSI_FuncGrp ^ SUSI_FuncState;}
+    void notifySusiRealSpeed(uint8_t Speed, SUSI_DIRECTION Dir) {BenchSink = Speed ^ Dir;}
+    void notifySusiBinaryState(uint8_t Command, uint8_t CommandState) {BenchSink = Command ^ CommandState;}
+};
+static BenchCallbacks BenchStatic;
+
+struct BenchResult {
+  uint32_t Min;
+  uint32_t Max;
+  uint32_t Sum;
+};
+
+static uint32_t BenchOverhead;                                                // cost of empty measurement
+
+static void benchStart(BenchResult& R) {
+  R.Min = 0xFFFFFFFF;
+  R.Max = 0;
+  R.Sum = 0;
+}
+
+static void benchAdd(BenchResult& R, uint32_t Start, uint32_t Stop) {
+  uint32_t Ticks = Stop - Start;
+  Ticks = (Ticks > BenchOverhead) ? (Ticks - BenchOverhead) : 0;
+  if (Ticks < R.Min) {R.Min = Ticks;}
+  if (Ticks > R.Max) {R.Max = Ticks;}
+  R.Sum += Ticks;
+}
+
+static void benchEnd(const char* Name, BenchResult& R) {
+  benchReport(Name, BENCH_LOOPS, R.Min, R.Sum / BENCH_LOOPS, R.Max);
+}
+
+static void benchFeed(const uint8_t* Packet, uint8_t Length) {                // packet to queue, not measured
+  SUSI.ResetReceiver();
+  for (uint8_t i = 0; i < Length; i++) {SUSI.ReceiveByte(Packet[i]);}
+}
+
+/* process() of one packet; Packet[1] (or Packet[2] for 3 byte) is changed every loop, to not hit the same value */
+/* with Static = true process(BenchStatic) is measured */
+static void benchProcess(const char* Name, uint8_t Cmnd, uint8_t Arg1, uint8_t Arg2, uint8_t Length, uint8_t VaryMask, bool Static = false) {
+  BenchResult R;
+  uint8_t Packet[3] = {Cmnd, Arg1, Arg2};
+  benchStart(R);
+  for (uint16_t i = 0; i < BENCH_LOOPS; i++) {
+    Packet[Length - 1] = (Packet[Length - 1] & ~VaryMask) | (i & VaryMask);
+    benchFeed(Packet, Length);
+    BENCH_LOCK();
+    uint32_t Start = BENCH_NOW();
+    if (Static) {SUSI.process(BenchStatic);} else {SUSI.process();}
+    uint32_t Stop = BENCH_NOW();
+    BENCH_UNLOCK();
+    benchAdd(R, Start, Stop);
+  }
+  benchEnd(Name, R);
+}
+
+static void benchRun(void) {
+  BenchResult R;
+
+  BenchOverhead = 0;                                                          // calibration: two reads of counter
+  benchStart(R);
+  for (uint16_t i = 0; i < BENCH_LOOPS; i++) {
+    BENCH_LOCK();
+    uint32_t Start = BENCH_NOW();
+    uint32_t Stop = BENCH_NOW();
+    BENCH_UNLOCK();
+    benchAdd(R, Start, Stop);
+  }
+  BenchOverhead = R.Min;
+
+  benchStart(R);                                                              // SPI1 interrupt, first byte of packet
+  for (uint16_t i = 0; i < BENCH_LOOPS; i++) {
+    SUSI.ResetReceiver();
+    BENCH_LOCK();
+    uint32_t Start = BENCH_NOW();
+    SUSI.ReceiveByte(0x60);
+    uint32_t Stop = BENCH_NOW();
+    BENCH_UNLOCK();
+    benchAdd(R, Start, Stop);
+  }
+  benchEnd("isr_byte", R);
+
+  benchStart(R);                                                              // SPI1 interrupt, last byte of packet (queue push)
+  for (uint16_t i = 0; i < BENCH_LOOPS; i++) {
+    SUSI.ResetReceiver();
+    SUSI.ReceiveByte(0x60);
+    BENCH_LOCK();
+    uint32_t Start = BENCH_NOW();
+    SUSI.ReceiveByte((uint8_t)i);
+    uint32_t Stop = BENCH_NOW();
+    BENCH_UNLOCK();
+    benchAdd(R, Start, Stop);
+    SUSI.process();                                                           // empty queue again
+  }
+  benchEnd("isr_packet", R);
+
+  benchStart(R);                                                              // TIM1 interrupt, gap with partial packet
+  for (uint16_t i = 0; i < BENCH_LOOPS; i++) {
+    SUSI.ResetReceiver();
+    SUSI.ReceiveByte(0x60);
+    BENCH_LOCK();
+    uint32_t Start = BENCH_NOW();
+    SUSI.ResetReceiver();
+    uint32_t Stop = BENCH_NOW();
+    BENCH_UNLOCK();
+    benchAdd(R, Start, Stop);
+  }
+  benchEnd("isr_gap", R);
+
+  benchProcess("function", 0x60, 0x00, 0x00, 2, 0x1F);                      // function group F0 - F4
+  benchProcess("speed", 0x50, 0x00, 0x00, 2, 0xFF);                         // real speed
+  benchProcess("cv_verify", 0x77, 0x80, 0x00, 3, 0xFF);                     // verify byte CV 897
+  benchProcess("cv_bit", 0x7B, 0x80, 0xE8, 3, 0x07);                        // verify bit of CV 897
+  benchProcess("broadcast", 0x6D, 0x00, 0x00, 2, 0x80);                     // all binary states on / off
+  benchProcess("function_static", 0x60, 0x00, 0x00, 2, 0x1F, true);         // the same with static callbacks
+  benchProcess("speed_static", 0x50, 0x00, 0x00, 2, 0xFF, true);
+  benchProcess("broadcast_static", 0x6D, 0x00, 0x00, 2, 0x80, true);
+}
+
+#endif
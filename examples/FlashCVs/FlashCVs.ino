@@ -0,0 +1,48 @@
+/*
+*	This example shows CVs stored in flash by wear levelled SUSI2FlashCV store:
+*   -   By turning on the LED built into the board when Function 0 is active.
+*   -   Allows reading/writing of CVs, each write appends one record to flash (page is erased only once per ~250 writes)
+*   -   Factory reset (write to CV8) forgets all stored CVs
+*   Note: last 2 KB of flash are used for CVs (SUSI_FLASH_CV_BASE in SUSI2FlashCV.h), sketch must be smaller than 14 KB.
+*/
+
+#include <SUSI2.h>        // Include the library for SUSI management
+#include <SUSI2FlashCV.h> // Include the CV store in flash
+
+#define LED_BUILTIN PD6   // CH32003 nano boards can differ. My one have LED on PD6
+
+SUSI2 SUSI;               // hardware receiver on PC5 and PC6 pins
+SUSI2FlashCV CVs;         // CV store, it uses reserved flash pages
+
+
+void notifySusiFunc(SUSI_FN_GROUP SUSI_FuncGrp, uint8_t SUSI_FuncState) {                                           // CallBack function that is invoked when a command for Functions is decoded
+    switch (SUSI_FuncGrp) {                                                                                         // Choose which function group the command belongs to
+        case SUSI_FN_0_4: {                                                                                         // Functions 0 to 4
+            ((SUSI_FuncState & SUSI_FN_BIT_00) ? digitalWrite(LED_BUILTIN, HIGH) : digitalWrite(LED_BUILTIN, LOW)); // if Function 0 is active I turn on the LED_BUILTIN
+            break;
+        }
+        default: {}
+    }
+}
+
+uint8_t notifySusiCVRead(uint8_t CV, uint8_t CVindex) {                                                             // CallBack function to read the value of a stored CV
+    return CVs.read(CV, CVindex);                                                                                   // from RAM index, 255 for CV never written
+}
+
+uint8_t notifySusiCVWrite(uint8_t CV, uint8_t CVindex, uint8_t Value) {                                             // CallBack function to write the value of a stored CV
+    return CVs.write(CV, CVindex, Value);                                                                           // nothing is written when value is the same
+}
+
+void notifyCVResetFactoryDefault(uint8_t Value) {                                                                   // CallBack function for reset to factory defaults
+    CVs.clear();                                                                                                    // all CVs return 255 (or default from read()) again
+}
+
+void setup() {                                                                                                      // Setup Code
+    pinMode(LED_BUILTIN, OUTPUT);                                                                                   // Set the pin to which the LED_BUILTIN is connected as output
+    CVs.begin();                                                                                                    // scan flash before first CV is requested
+    SUSI.init();                                                                                                    // Start the library
+}
+
+void loop() {                                                                                                       // Code loop
+    SUSI.process();                                                                                                 // Process the data acquired from the library as many times as possible
+}
@@ -0,0 +1,20 @@
+/*
+  Minimal Arduino.h replacement for host (Linux) build of SUSI2 protocol core.
+  Only what SUSI2.cpp needs is here - no pins, no peripherals. Hardware is simulated in SUSI2_Sim.cpp.
+*/
+
+#ifndef SUSI2_HOST_ARDUINO_H
+#define SUSI2_HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef SUSI_HOST_BUILD
+#define SUSI_HOST_BUILD
+#endif
+
+uint32_t micros(void);                                                        // virtual time, see susiSimAdvance()
+uint32_t millis(void);
+void delayMicroseconds(uint32_t us);                                          // only moves virtual time
+
+#endif
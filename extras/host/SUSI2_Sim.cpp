@@ -0,0 +1,146 @@
+/*
+  Simulated hardware backend for host (Linux) build of SUSI2.
+  Implements the hardware part of class SUSI2 (the same members as SUSI2_CH32.cpp) without any peripheral.
+*/
+
+#include "SUSI2_Sim.h"
+#include "SUSI2FlashCV.h"
+
+static uint32_t SimTime;                                                      // virtual time in microseconds
+static uint32_t AckEnd;                                                       // virtual time, when running ACK pulse ends
+static uint32_t AckCount;                                                     // number of ACK pulses since init
+#ifdef SUSI_USE_BIDI
+static uint8_t Transmit = SUSI_BIDI_IDLE;                                     // SPI transmit buffer (BiDi answer)
+#endif
+static SUSI_ACK_STATUS AckStatus;                                             // Status of ACK pulse
+static uint32_t SimFlash[SUSI_FLASH_CV_PAGES * SUSI_FLASH_PAGE_SIZE / 4];     // emulated flash of CV store
+static bool SimFlashReady;                                                    // emulated flash is erased after start
+static uint32_t FlashErases;                                                  // number of page erases
+static bool FlashFail;                                                        // erase and program fail
+
+uint32_t micros(void) {
+  return SimTime;
+}
+
+uint32_t millis(void) {
+  return SimTime / 1000;
+}
+
+void delayMicroseconds(uint32_t us) {
+  susiSimAdvance(us);
+}
+
+void susiSimAdvance(uint32_t Microseconds) {
+  SimTime += Microseconds;
+  if ((AckStatus == SUSI_ACK_BUSY) && ((int32_t)(SimTime - AckEnd) >= 0)) {   // the same as Timer2 interrupt
+    AckStatus = SUSI_ACK_DONE;
+  }
+}
+
+void susiSimByte(uint8_t Data) {
+  susiSimAdvance(80);                                                         // 8 bits at 10 us per bit
+#ifdef SUSI_USE_BIDI
+  Data &= Transmit;                                                           // data line is wired AND of master and module
+  Transmit = SusiPort<SUSI_SPI>::Bus->BiDiTransmit(Data);
+#endif
+  SusiPort<SUSI_SPI>::Bus->ReceiveByte(Data);                                 // the same as SPI1 interrupt
+}
+
+void susiSimLost(void) {
+  susiSimAdvance(80);                                                         // byte is shifted in, but previous one was not read yet
+  SusiPort<SUSI_SPI>::Bus->OverrunReceiver();                                 // the same as overrun flag in next SPI1 interrupt
+}
+
+void susiSimBytes(const uint8_t* Data, size_t Length) {
+  for (size_t i = 0; i < Length; i++) {susiSimByte(Data[i]);}
+}
+
+void susiSimGap(void) {
+  susiSimAdvance(SusiPort<SUSI_SPI>::Bus->getGap());
+  SusiPort<SUSI_SPI>::Bus->GapReceiver();                                     // the same as Timer1 interrupt
+#ifdef SUSI_USE_BIDI
+  Transmit = SUSI_BIDI_IDLE;
+#endif
+}
+
+uint32_t susiSimAckCount(void) {
+  return AckCount;
+}
+
+uint32_t susiSimFlashErases(void) {
+  return FlashErases;
+}
+
+void susiSimFlashFail(bool Fail) {
+  FlashFail = Fail;
+}
+
+/**********************************************************************************************************************/
+/* Emulated flash - program can only clear bits of erased word, like real one */
+
+static uint32_t* SimFlashWord(uint32_t Address) {
+  if (!SimFlashReady) {
+    for (size_t i = 0; i < sizeof(SimFlash) / 4; i++) {SimFlash[i] = 0xFFFFFFFF;}
+    SimFlashReady = true;
+  }
+  uint32_t Offset = Address - SUSI_FLASH_CV_BASE;
+  if ((Address < SUSI_FLASH_CV_BASE) || (Offset >= sizeof(SimFlash)) || (Offset & 3)) {return NULL;}
+  return &SimFlash[Offset / 4];
+}
+
+bool susiFlashErase(uint32_t Address) {
+  uint32_t* Word = SimFlashWord(Address & ~(uint32_t)(SUSI_FLASH_PAGE_SIZE - 1));
+  if ((Word == NULL) || (FlashFail)) {return false;}
+  for (int i = 0; i < SUSI_FLASH_PAGE_SIZE / 4; i++) {Word[i] = 0xFFFFFFFF;}
+  FlashErases++;
+  return true;
+}
+
+bool susiFlashProgram(uint32_t Address, uint32_t Data) {
+  uint32_t* Word = SimFlashWord(Address);
+  if ((Word == NULL) || (*Word != 0xFFFFFFFF) || (FlashFail)) {return false;}
+  *Word = Data;
+  return true;
+}
+
+uint32_t susiFlashRead(uint32_t Address) {
+  uint32_t* Word = SimFlashWord(Address);
+  return (Word == NULL) ? 0xFFFFFFFF : *Word;
+}
+
+/**********************************************************************************************************************/
+/* Hardware part of class */
+
+SUSI2::~SUSI2(void) {
+  if (SusiPort<SUSI_SPI>::Bus == this) {SusiPort<SUSI_SPI>::Bus = 0;}
+}
+
+void SUSI2::initSPI() {
+}
+
+void SUSI2::StopReceiver() {
+}
+
+void SUSI2::initTimer1() {
+}
+
+void SUSI2::setTimer1Gap() {
+}
+
+void SUSI2::initTimer2() {
+  AckStatus = SUSI_ACK_IDLE;
+  AckCount = 0;
+}
+
+void SUSI2::SendACK() {
+  AckStatus = SUSI_ACK_BUSY;
+  AckEnd = SimTime + SUSI_ACK_LENGTH;
+  AckCount++;
+}
+
+void SUSI2::waitForPacket() {                                                 // no sleep on host, bytes come from test code
+}
+
+SUSI_ACK_STATUS SUSI2::getAckStatus(void) {
+  return AckStatus;
+}
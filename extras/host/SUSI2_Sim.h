@@ -0,0 +1,81 @@
+/*
+  Simulated hardware backend for host (Linux) build of SUSI2.
+
+  Replaces SUSI2_CH32.cpp. Instead of SPI1 interrupt the test code push bytes by susiSimByte(),
+  instead of Timer1 gap the test code call susiSimGap(). Time is virtual, it moves only by susiSimAdvance()
+  (or by delayMicroseconds()), then runs are repeatable.
+*/
+
+#ifndef SUSI2_SIM_H
+#define SUSI2_SIM_H
+
+#include "SUSI2.h"
+
+/*
+*   susiSimByte() One byte shifted in by SPI (the same as SPI1 RX interrupt on target)
+*   With SUSI_USE_BIDI received byte is AND of master byte and module answer (open drain data line)
+*   Input:
+*       - received byte
+*   Returns:
+*       - None
+*/
+void susiSimByte(uint8_t Data);
+/*
+*   susiSimLost() One byte lost by SPI overrun (interrupt was late), receiver sees overrun after the previous byte
+*   Input:
+*       - None
+*   Returns:
+*       - None
+*/
+void susiSimLost(void);
+/*
+*   susiSimBytes() More bytes shifted in by SPI, one after another without gap
+*   Input:
+*       - pointer to bytes
+*       - number of bytes
+*   Returns:
+*       - None
+*/
+void susiSimBytes(const uint8_t* Data, size_t Length);
+/*
+*   susiSimGap() Gap on SUSI clock longer than getGap() (the same as Timer1 interrupt on target), virtual time moves by the gap
+*   Input:
+*       - None
+*   Returns:
+*       - None
+*/
+void susiSimGap(void);
+/*
+*   susiSimAdvance() Move virtual time, ACK pulse ends when its time elapses
+*   Input:
+*       - microseconds
+*   Returns:
+*       - None
+*/
+void susiSimAdvance(uint32_t Microseconds);
+/*
+*   susiSimAckCount() Number of ACK pulses started since init()
+*   Input:
+*       - None
+*   Returns:
+*       - count of ACK pulses
+*/
+uint32_t susiSimAckCount(void);
+/*
+*   susiSimFlashErases() Number of page erases of emulated flash (for wear check of SUSI2FlashCV)
+*   Input:
+*       - None
+*   Returns:
+*       - count of erases since start
+*/
+uint32_t susiSimFlashErases(void);
+/*
+*   susiSimFlashFail() Make emulated flash fail - erase and program return false (worn out flash, brown-out)
+*   Input:
+*       - true = fail, false = work again
+*   Returns:
+*       - None
+*/
+void susiSimFlashFail(bool Fail);
+
+#endif
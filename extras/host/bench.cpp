@@ -0,0 +1,39 @@
+/*
+  Benchmark for host build of SUSI2 - the same cases as examples/Benchmark (target), the same output format:
+      bench,<name>,<count>,<min>,<avg>,<max>
+  values are in TSC ticks on x86, nanoseconds elsewhere (see line "meta,unit,...").
+  For deeper look run it under "perf record".
+*/
+
+#include <stdio.h>
+
+#include "SUSI2.h"
+#include "SUSI2_Sim.h"
+
+SUSI2 SUSI;
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_NOW()     ((uint32_t)__rdtsc())
+#define BENCH_UNIT      "tsc"
+#else
+#include <chrono>
+#define BENCH_NOW()     ((uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count())
+#define BENCH_UNIT      "ns"
+#endif
+#define BENCH_LOCK()
+#define BENCH_UNLOCK()
+
+void benchReport(const char* Name, uint32_t Count, uint32_t Min, uint32_t Avg, uint32_t Max) {
+  printf("bench,%s,%u,%u,%u,%u\n", Name, Count, Min, Avg, Max);
+}
+
+#include "../../examples/Benchmark/SusiBench.h"
+
+int main(void) {
+  SUSI.init();
+  printf("meta,target,host\n");
+  printf("meta,unit,%s\n", BENCH_UNIT);
+  benchRun();
+  return 0;
+}
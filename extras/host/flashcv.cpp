@@ -0,0 +1,103 @@
+/*
+  Test of SUSI2FlashCV for host build (built with SUSI_USE_FLASH_CV, emulated flash of SUSI2_Sim.cpp).
+
+  Checks write by SUSI packets, compaction (one erase per full page), recovery of values after restart,
+  full RAM index and failing flash. Every failed check is printed, exit code is number of failed checks.
+*/
+
+#include <stdio.h>
+
+#include "SUSI2.h"
+#include "SUSI2_Sim.h"
+#include "SUSI2FlashCV.h"
+
+SUSI2 SUSI;
+
+static int Failures;
+
+#define CHECK(Condition)    do { if (!(Condition)) {printf("%s:%d: failed: %s\n", __FILE__, __LINE__, #Condition); Failures++;} } while (0)
+
+int main(void) {
+  // First access formats empty flash (one erase), init() writes default module address (CV897 = 1)
+  SUSI.init();
+  CHECK(susiSimFlashErases() == 1);
+  CHECK(SusiFlashCV.read(0, 0) == 1);
+
+  // Write and check by SUSI packets - CV callbacks are the weak ones of library (SUSI_USE_FLASH_CV)
+  const uint8_t Write[] = {0x7F, 0x85, 0x07};                               // CV902 = 7
+  const uint8_t Check[] = {0x77, 0x85, 0x07};                               // CV902 == 7?
+  susiSimBytes(Write, sizeof(Write));
+  SUSI.process();
+  CHECK(susiSimAckCount() == 1);
+  susiSimAdvance(SUSI_ACK_LENGTH);
+  susiSimBytes(Check, sizeof(Check));
+  SUSI.process();
+  CHECK(susiSimAckCount() == 2);
+  CHECK(SusiFlashCV.read(5, 0) == 7);
+
+  // The same value is not written again
+  uint16_t Free = SusiFlashCV.freeRecords();
+  CHECK(SusiFlashCV.write(5, 0, 7) == 7);
+  CHECK(SusiFlashCV.freeRecords() == Free);
+
+  // Page is filled without erase, next write compacts actual values to next page (one erase)
+  uint8_t Value = 0;
+  while (SusiFlashCV.freeRecords() > 0) {
+    Value++;
+    CHECK(SusiFlashCV.write(6, 0, Value) == Value);
+  }
+  CHECK(susiSimFlashErases() == 1);
+  Value++;
+  CHECK(SusiFlashCV.write(6, 0, Value) == Value);
+  CHECK(susiSimFlashErases() == 2);
+  CHECK(SusiFlashCV.freeRecords() == SUSI_FLASH_RECORDS - 3);              // only actual values of CV897, CV902, CV903
+  CHECK(SusiFlashCV.write(5, 3, 0x33) == 0x33);                             // the same CV in other bank is other key
+
+  // Restart - new object builds RAM index from flash
+  {
+    SUSI2FlashCV Restarted;
+    CHECK(Restarted.read(0, 0) == 1);
+    CHECK(Restarted.read(5, 0) == 7);
+    CHECK(Restarted.read(5, 3) == 0x33);
+    CHECK(Restarted.read(6, 0) == Value);
+    CHECK(Restarted.read(7, 0, 0x55) == 0x55);                              // never written
+    CHECK(Restarted.freeRecords() == SusiFlashCV.freeRecords());
+  }
+  CHECK(susiSimFlashErases() == 2);
+
+  // Full RAM index - write of one more CV fails (no ACK), stored ones still work
+  uint8_t Keys = 4;
+  for (uint8_t Index = 0; Keys < SUSI_FLASH_CV_KEYS; Index++, Keys++) {
+    CHECK(SusiFlashCV.write(10, Index, Index) == Index);
+  }
+  CHECK(SusiFlashCV.write(11, 0, 0x12) != 0x12);
+  CHECK(SusiFlashCV.read(11, 0, 0x55) == 0x55);
+  CHECK(SusiFlashCV.write(6, 0, 0x77) == 0x77);
+
+  // Failing flash on compaction - new CV is not kept in RAM index, stored CV keeps old value
+  SusiFlashCV.clear();
+  uint32_t Erases = susiSimFlashErases();
+  Value = 0;
+  while (SusiFlashCV.freeRecords() > 0) {
+    Value++;
+    SusiFlashCV.write(6, 0, Value);
+  }
+  susiSimFlashFail(true);
+  CHECK(SusiFlashCV.write(7, 0, 0x21) != 0x21);
+  CHECK(SusiFlashCV.read(7, 0, 0x55) == 0x55);                              // no phantom value
+  CHECK(SusiFlashCV.write(6, 0, 0xA0) == Value);
+  CHECK(SusiFlashCV.read(6, 0) == Value);
+  susiSimFlashFail(false);
+  CHECK(susiSimFlashErases() == Erases);
+  CHECK(SusiFlashCV.write(7, 0, 0x21) == 0x21);                             // flash works again - compaction
+  CHECK(susiSimFlashErases() == Erases + 1);
+  {
+    SUSI2FlashCV Restarted;
+    CHECK(Restarted.read(6, 0) == Value);
+    CHECK(Restarted.read(7, 0) == 0x21);
+    CHECK(Restarted.read(0, 0, 0x55) == 0x55);                              // clear() forgot everything
+  }
+
+  printf("%s, %d failed\n", Failures ? "FAILED" : "OK", Failures);
+  return Failures;
+}
@@ -0,0 +1,183 @@
+/*
+  Trace replay for host build of SUSI2.
+
+  Reads SUSI byte trace (file or stdin) and feeds it to decoder by simulated backend. Every callback is printed,
+  one line per call, then output of two versions of library can be compared by diff.
+
+  Trace format (text):
+    hex bytes separated by spaces / new lines      e.g. "60 01 61 00"
+    G                                              gap on SUSI clock (> 7 ms) - receiver resynchronization
+    L                                              byte lost by SPI overrun
+    P                                              call process() now (otherwise it is called after each line)
+    T100                                           move virtual time by 100 ms (CV cache flush delay)
+    M2                                             serve also module 2 (addModule), M1 .. M3
+    X2                                             do not serve module 2 any more (removeModule), X1 .. X3
+    U                                              queue only pairs and CV manipulation (unsubscribeAll)
+    S60-68                                         queue also commands 0x60 .. 0x68 (subscribe), S21 = one command
+    R8F:05                                         answer BiDi command 0x8F by 0x05 (setBiDi, build with SUSI_USE_BIDI)
+    # comment                                      till end of line
+
+  CVs are kept in RAM (all zero at start), CV writes are visible for next reads. Built with REPLAY_MODULE_CV, CVs are accessed
+  by notifySusiModuleCVRead/Write (module number is printed) instead of notifySusiCVRead/Write.
+  Options:
+    -e      packets are decoded by poll() and events are printed instead of callbacks (CV callbacks are printed always)
+    -c      only changed states are notified (notifyChangesOnly)
+    -s      packets are decoded by process(Callbacks) - static callbacks of class below, only function groups, binary states,
+            real speed and unknown commands are implemented there (others are inherited empty ones of SusiCallbacks)
+    -b4     bounded process(4, 0) - at most 4 packets per call, packets left in queue are printed
+    -t250   bounded process(0, 250) - at most 250 us per call, decoding of every packet takes 100 us of virtual time
+  Runtime statistics (getStats) are printed at the end.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "SUSI2.h"
+#include "SUSI2_Sim.h"
+
+SUSI2 SUSI;
+
+static uint8_t CVs[128][256];                                                 // CV 897 .. 1024, for each index
+
+static uint32_t DecodeTime;                                                   // virtual time of decoding one packet (-t)
+
+void notifySusiRawMessage(uint8_t firstByte, uint8_t secondByte) {printf("raw %02X %02X\n", firstByte, secondByte); susiSimAdvance(DecodeTime);}
+void notifySusiRawMessage3b(uint8_t firstByte, uint8_t secondByte, uint8_t thirdByte) {printf("raw3 %02X %02X %02X\n", firstByte, secondByte, thirdByte); susiSimAdvance(DecodeTime);}
+void notifySusiFunc(SUSI_FN_GROUP SUSI_FuncGrp, uint8_t SUSI_FuncState) {printf("func %u %02X\n", SUSI_FuncGrp, SUSI_FuncState);}
+void notifySusiBinaryState(uint8_t Command, uint8_t CommandState) {printf("binary %u %u\n", Command, CommandState);}
+void notifySusiBinaryStateL(uint16_t Command, uint8_t CommandState) {printf("binaryL %u %u\n", Command, CommandState);}
+void notifySusiAux(SUSI_AUX_GROUP SUSI_auxGrp, uint8_t SUSI_AuxState) {printf("aux %u %02X\n", SUSI_auxGrp, SUSI_AuxState);}
+void notifySusiTriggerPulse(uint8_t state) {printf("trigger %u\n", state);}
+void notifySusiMotorCurrent(int8_t current) {printf("current %d\n", current);}
+void notifySusiRequestSpeed(uint8_t Speed, SUSI_DIRECTION Dir) {printf("requestSpeed %u %u\n", Speed, Dir);}
+void notifySusiDCCSpeed(uint8_t Speed, SUSI_DIRECTION Dir) {printf("dccSpeed %u %u\n", Speed, Dir);}
+void notifySusiRealSpeed(uint8_t Speed, SUSI_DIRECTION Dir) {printf("realSpeed %u %u\n", Speed, Dir);}
+void notifySusiMotorLoad(int8_t load) {printf("load %d\n", load);}
+void notifySusiAnalogFunction(SUSI_AN_GROUP SUSI_AnalogGrp, uint8_t SUSI_AnalogState) {printf("analog %u %u\n", SUSI_AnalogGrp, SUSI_AnalogState);}
+void notifySusiAnalogDirectCommand(uint8_t functionNumber, uint8_t Value) {printf("analogDirect %u %u\n", functionNumber, Value);}
+void notifySusiNoOperation(uint8_t commandArgument) {printf("nop %u\n", commandArgument);}
+void notifySusiMasterAddress(uint16_t MasterAddress) {printf("master %u\n", MasterAddress);}
+void notifySusiControllModule(uint8_t ModuleControll) {printf("module %02X\n", ModuleControll);}
+void notifySusiUnknownMessage(uint8_t firstByte, uint8_t secondByte) {printf("unknown %02X %02X\n", firstByte, secondByte);}
+uint8_t notifySusiCVRead(uint8_t CV, uint8_t CVindex) {printf("cvRead %u %u\n", CV + 897, CVindex); return CVs[CV][CVindex];}
+uint8_t notifySusiCVWrite(uint8_t CV, uint8_t CVindex, uint8_t Value) {printf("cvWrite %u %u %u\n", CV + 897, CVindex, Value); CVs[CV][CVindex] = Value; return Value;}
+#ifdef REPLAY_MODULE_CV
+uint8_t notifySusiModuleCVRead(uint8_t Module, uint8_t CV, uint8_t CVindex) {printf("moduleCvRead %u %u %u\n", Module, CV + 897, CVindex); return CVs[CV][CVindex];}
+uint8_t notifySusiModuleCVWrite(uint8_t Module, uint8_t CV, uint8_t CVindex, uint8_t Value) {printf("moduleCvWrite %u %u %u %u\n", Module, CV + 897, CVindex, Value); CVs[CV][CVindex] = Value; return Value;}
+#endif
+void notifySusiCVCommit(void) {printf("cvCommit\n");}
+void notifyCVResetFactoryDefault(uint8_t Value) {printf("cvReset %u\n", Value); memset(CVs, 0, sizeof(CVs));}
+
+class ReplayCallbacks : public SusiCallbacks<ReplayCallbacks> {
+  public:
+    void notifySusiFunc(SUSI_FN_GROUP SUSI_FuncGrp, uint8_t SUSI_FuncState) {printf("static func %u %02X\n", SUSI_FuncGrp, SUSI_FuncState);}
+    void notifySusiBinaryState(uint8_t Command, uint8_t CommandState) {printf("static binary %u %u\n", Command, CommandState);}
+    void notifySusiRealSpeed(uint8_t Speed, SUSI_DIRECTION Dir) {printf("static realSpeed %u %u\n", Speed, Dir);}
+    void notifySusiUnknownMessage(uint8_t firstByte, uint8_t secondByte) {printf("static unknown %02X %02X\n", firstByte, secondByte);}
+};
+
+static ReplayCallbacks Callbacks;
+static bool Events;                                                           // -e: poll() instead of process()
+static bool Static;                                                           // -s: process(Callbacks)
+static uint8_t MaxPackets;                                                    // -b: packet budget of process()
+static uint16_t MaxMicros;                                                    // -t: time budget of process()
+
+static void Process(void) {
+  uint32_t Acks = susiSimAckCount();
+  if (Events) {
+    SusiEvent Event;
+    while (SUSI.poll(Event)) {printf("event %u %u %u %u\n", Event.Kind, Event.Group, Event.Value, Event.Number);}
+  } else if ((MaxPackets) || (MaxMicros)) {
+    printf("left %u\n", SUSI.process(MaxPackets, MaxMicros));
+  } else if (Static) {
+    SUSI.process(Callbacks);
+  } else {
+    SUSI.process();
+  }
+  if (susiSimAckCount() != Acks) {printf("ack\n");}
+}
+
+int main(int argc, char** argv) {
+  FILE* In = stdin;
+  bool ChangesOnly = false;
+  while ((argc > 1) && (argv[1][0] == '-') && (argv[1][1] != 0)) {
+    if (strcmp(argv[1], "-e") == 0) {Events = true;}
+    else if (strcmp(argv[1], "-c") == 0) {ChangesOnly = true;}
+    else if (strcmp(argv[1], "-s") == 0) {Static = true;}
+    else if (strncmp(argv[1], "-b", 2) == 0) {MaxPackets = (uint8_t)atoi(argv[1] + 2);}
+    else if (strncmp(argv[1], "-t", 2) == 0) {MaxMicros = (uint16_t)atoi(argv[1] + 2); DecodeTime = 100;}
+    else {fprintf(stderr, "unknown option: %s\n", argv[1]); return 1;}
+    argc--;
+    argv++;
+  }
+  if (argc > 1) {
+    In = fopen(argv[1], "r");
+    if (!In) {perror(argv[1]); return 1;}
+  }
+
+  SUSI.init();
+  SUSI.notifyChangesOnly(ChangesOnly);
+
+  char Line[1024];
+  while (fgets(Line, sizeof(Line), In)) {
+    char* p = Line;
+    char* Comment = strchr(p, '#');
+    if (Comment) {*Comment = 0;}
+    while (*p) {
+      if (isspace((unsigned char)*p)) {p++; continue;}
+      if ((*p == 'G') || (*p == 'g')) {Process(); susiSimGap(); p++; continue;}
+      if ((*p == 'P') || (*p == 'p')) {Process(); p++; continue;}
+      if ((*p == 'L') || (*p == 'l')) {susiSimLost(); p++; continue;}
+      if (((*p == 'M') || (*p == 'm')) && (p[1] >= '1') && (p[1] <= '3')) {SUSI.addModule(p[1] - '0'); p += 2; continue;}
+      if (((*p == 'X') || (*p == 'x')) && (p[1] >= '1') && (p[1] <= '3')) {SUSI.removeModule(p[1] - '0'); p += 2; continue;}
+      if ((*p == 'T') || (*p == 't')) {
+        char* End;
+        unsigned long Milliseconds = strtoul(p + 1, &End, 10);
+        if (End == p + 1) {fprintf(stderr, "bad token: %s", p); return 1;}
+        susiSimAdvance(Milliseconds * 1000);
+        p = End;
+        continue;
+      }
+      if ((*p == 'U') || (*p == 'u')) {SUSI.unsubscribeAll(); p++; continue;}
+      if ((*p == 'S') || (*p == 's')) {
+        char* End;
+        unsigned long First = strtoul(p + 1, &End, 16);
+        unsigned long Last = (*End == '-') ? strtoul(End + 1, &End, 16) : First;
+        if ((End == p + 1) || (First > Last) || (Last > 0xFF)) {fprintf(stderr, "bad token: %s", p); return 1;}
+        SUSI.subscribe((uint8_t)First, (uint8_t)Last);
+        p = End;
+        continue;
+      }
+#ifdef SUSI_USE_BIDI
+      if ((*p == 'R') || (*p == 'r')) {
+        char* End;
+        unsigned long Command = strtoul(p + 1, &End, 16);
+        unsigned long Answer = (*End == ':') ? strtoul(End + 1, &End, 16) : 0x100;
+        if ((Command > 0xFF) || (Answer > 0xFF) || (!SUSI.setBiDi((uint8_t)Command, (uint8_t)Answer))) {fprintf(stderr, "bad token: %s", p); return 1;}
+        p = End;
+        continue;
+      }
+#endif
+      char* End;
+      unsigned long Value = strtoul(p, &End, 16);
+      if ((End == p) || (Value > 0xFF)) {fprintf(stderr, "bad token: %s", p); return 1;}
+      susiSimByte((uint8_t)Value);
+      p = End;
+    }
+    Process();
+  }
+  if (In != stdin) {fclose(In);}
+#ifdef SUSI_CV_CACHE_SIZE
+  SUSI.flushCVs();                                                            // cached writes at the end of trace
+#endif
+#ifndef SUSI_NO_STATS
+  SusiStats Stats = SUSI.getStats();
+  printf("stats bytes=%u function=%u binary=%u motion=%u analog=%u control=%u cv=%u unknown=%u drops=%u gaps=%u partial=%u overruns=%u resyncs=%u highwater=%u\n",
+         Stats.Bytes, Stats.Packets[SUSI_STAT_FUNCTION], Stats.Packets[SUSI_STAT_BINARY], Stats.Packets[SUSI_STAT_MOTION],
+         Stats.Packets[SUSI_STAT_ANALOG], Stats.Packets[SUSI_STAT_CONTROL], Stats.Packets[SUSI_STAT_CV], Stats.Unknown,
+         Stats.QueueDrops, Stats.GapResets, Stats.PartialResets, Stats.Overruns, Stats.Resyncs, Stats.QueueHighWater);
+#endif
+  return 0;
+}
@@ -0,0 +1,13 @@
+# Regression test of host build: replay trace and compare printed callbacks with expected output.
+# Usage: cmake -DREPLAY=<susi2_replay> -DTRACE=<name.txt> -DEXPECTED=<name.out> [-DOPTIONS=-e] -P replay_test.cmake
+# On difference actual output is left in working directory (<name>.actual), compare it by diff.
+execute_process(COMMAND ${REPLAY} ${OPTIONS} ${TRACE} OUTPUT_VARIABLE Output RESULT_VARIABLE Result)
+if(NOT Result EQUAL 0)
+  message(FATAL_ERROR "${REPLAY} failed: ${Result}")
+endif()
+file(READ ${EXPECTED} Expected)
+if(NOT Output STREQUAL Expected)
+  get_filename_component(Name ${EXPECTED} NAME_WE)
+  file(WRITE ${Name}.actual "${Output}")
+  message(FATAL_ERROR "output differs from ${EXPECTED}, see ${Name}.actual")
+endif()
@@ -43,4 +43,31 @@
 #define	SUSI_AN_FN_8		7
 
 
+/* ACK pulse status */
+#define	SUSI_ACK_STATUS		uint8_t
+#define	SUSI_ACK_IDLE		0		// no ACK sent since init
+#define	SUSI_ACK_BUSY		1		// ACK pulse is running (data line held low)
+#define	SUSI_ACK_DONE		2		// last ACK pulse finished, data line released
+
+
+/* Event kind of SusiEvent (SUSI2::poll) */
+#define	SUSI_EVENT_KIND				uint8_t
+#define	SUSI_EVENT_FUNC				0		// Group = SUSI_FN_x, Value = state of functions
+#define	SUSI_EVENT_AUX				1		// Group = SUSI_AUX_x, Value = state of AUXs
+#define	SUSI_EVENT_BINARY			2		// Number = binary state 1 .. 32767, Value = state (0 / 1)
+#define	SUSI_EVENT_BINARY_ALL		3		// Number = last binary state (127 short form, 32767 long form), Value = state of all
+#define	SUSI_EVENT_TRIGGER			4		// Value = trigger pulse argument
+#define	SUSI_EVENT_CURRENT			5		// Value = motor current (int8_t)
+#define	SUSI_EVENT_REAL_SPEED		6		// Value = speed 0 .. 127, Group = SUSI_DIR_x
+#define	SUSI_EVENT_REQUEST_SPEED	7		// Value = speed 0 .. 127, Group = SUSI_DIR_x
+#define	SUSI_EVENT_DCC_SPEED		8		// Value = speed 0 .. 127, Group = SUSI_DIR_x
+#define	SUSI_EVENT_LOAD				9		// Value = motor load (int8_t)
+#define	SUSI_EVENT_ANALOG			10		// Group = SUSI_AN_FN_x, Value = analog value
+#define	SUSI_EVENT_ANALOG_DIRECT	11		// Group = direct command 1 / 2, Value = bits
+#define	SUSI_EVENT_NOP				12		// Value = argument of no operation
+#define	SUSI_EVENT_MASTER_ADDRESS	13		// Number = digital address of master
+#define	SUSI_EVENT_MODULE_CONTROL	14		// Value = module control byte
+#define	SUSI_EVENT_UNKNOWN			15		// Group = command, Value = argument
+
+
 #endif
@@ -13,46 +13,68 @@
 
 #include "SUSI2.h"                                                                                 // Header
 
-#ifdef  TIM_MODULE_ENABLED
-#include <HardwareTimer.h>                                                    // Include HardwareTimer for compatibility
-HardwareTimer myTimer(TIM1);                                                  // define object, to present we occupy Timer 1
-#endif
-
-SUSI2* pointerToSUSI;                                                         // Pointer to the SUSI Class
-PacketT partial;                                                              // partially received packet - used in ISR routine
-uint8_t ByteCount;                                                            // Counter of bytes in packet - used in ISR routine
+// This file is protocol core only. Everything touching hardware (SPI, timers, DMA, interrupts, ACK pin) is in hardware
+// backend: SUSI2_CH32.cpp for CH32V003, extras/host/SUSI2_Sim.cpp for host (Linux) build.
 
 /**********************************************************************************************************************/
 /* Constructor and Destructor */
 
-SUSI2::SUSI2() {                                                                                    // Class constructor
-}                                                                                                       // empty for now
+SUSI2::SUSI2() : ModuleMask(0), ChangeOnly(false), GapTime(SUSI_GAP_TIME) {                             // Class constructor
+  subscribeAll();                                                                                       // by default all commands are queued
+}
 
-SUSI2::SUSI2(uint8_t CLK_pin, uint8_t DATA_pin) {                                                       // Class constructor
+SUSI2::SUSI2(uint8_t CLK_pin, uint8_t DATA_pin) : ModuleMask(0), ChangeOnly(false), GapTime(SUSI_GAP_TIME) {  // Class constructor
+  subscribeAll();                                                                                       // by default all commands are queued
   (void)(CLK_pin);                                                                                      // Have no usage for parameter "CLK_pin", will mark it as "unused"
   (void)(DATA_pin);                                                                                     // Have no usage for parameter "DATA_pin", will mark it as "unused"
 }                                                                                                       // This one is for compatibility only. Pin assignment is fixed for the hardware
 
-SUSI2::~SUSI2(void) {                                                                                   // Class Destructor
-  SPI_Cmd( SPI1, DISABLE );                                                                             // stop SPI receiver
-  TIM_Cmd( TIM1, DISABLE );                                                                             // stop Timer1 functions
-}
-
 /**********************************************************************************************************************/
 /* Initializing Library */
 
-void SUSI2::initClass(void) {
-  pointerToSUSI = this;                                                                             // I assign the pointer the address of the following class
+bool SUSI2::initClass(void) {
+  if ((SusiPort<SUSI_SPI>::Bus) && (SusiPort<SUSI_SPI>::Bus != this)) {return false;}               // peripherals are used by other object
+  if (SusiPort<SUSI_SPI>::Bus == this) {StopReceiver();}                                            // repeated init: interrupts must not fill queue being cleared
+  SusiPort<SUSI_SPI>::Bus = this;                                                                   // interrupt handlers of SPI work with this object
+  ModuleMask = SUSI_MODULE_BIT(_slaveAddress);                                                      // primary module only, others by addModule()
 
-  for (BufferR=0; BufferR<BUFFER_SIZE; BufferR++) {MyBuffer[BufferR].W = 0;};    // empty buffer
-  ByteCount=0;          // Counter of bytes in packet
-  BufferR=BufferW=0;    // Buffer read and write position
-  partial.W=0;          // empty partially received
+  Queue.clear();        // empty queue
+#ifndef SUSI_NO_PRIORITY
+  Priority.clear();
+#endif
+#ifdef SUSI_COALESCE
+  for (uint8_t i=0; i<SUSI_COALESCE_SLOTS; i++) {LatestPending[i] = 0;}
+#endif
+#ifdef SUSI_REORDER
+  LastQueued = 0;
+#endif
+#ifndef SUSI_NO_TIMESTAMPS
+  LastPacketTime=0;     // nothing decoded yet
+#endif
+  ResetReceiver();      // empty partially received packet
+  WaitHighBinary=0;     // no pair open
+#ifndef SUSI_NO_STATS
+  Counters = SusiStats();                            // statistics from init (all zero)
+  BytesAtGap=0;
+#endif
+  for (uint8_t i=0; i<MIRROR_SIZE; i++) {Mirror[i] = 0;}   // nothing decoded yet
+  MirrorKnown=0;        // first value of each state will be notified
+#ifdef SUSI_CV_CACHE_SIZE
+  for (uint8_t i=0; i<SUSI_CV_CACHE_SIZE; i++) {CVCache[i].State = SUSI_CV_EMPTY;}   // nothing cached yet
+  CacheDirty=false;
+  CommitPending=false;
+#endif
+  UpdateBinaryStates(false);  // all binary states off
+#ifdef SUSI_USE_BIDI
+  for (uint8_t i=0; i<SUSI_BIDI_SLOTS; i++) {BiDiCommand[i] = 0;}   // no answers
+#endif
+  initTimer2();         // initialize Timer2 for ACK pulse
   initSPI();            // initialize SIP for receive
   initTimer1();         // initialize Timer1 for synchronization
+  return true;
 }
 
-void SUSI2::init(void) {
+bool SUSI2::init(void) {
     if (notifySusiCVRead) {                                                                             // If CV storage system is present
         _slaveAddress = notifySusiCVRead(ADDRESS_CV,0);                                                   // I read the value stored in the CV of the address
 
@@ -67,752 +89,467 @@ void SUSI2::init(void) {
         _slaveAddress = DEFAULT_SLAVE_NUMBER;                                                           // I use the default address: 1
     }
     
-    initClass();                                                                                        // I initialize the class and its components
+    return initClass();                                                                                 // I initialize the class and its components
 }
 
-void SUSI2::init(uint8_t SlaveAddress) {                                                                // Initialization with user-chosen address in code
+bool SUSI2::init(uint8_t SlaveAddress) {                                                                // Initialization with user-chosen address in code
     _slaveAddress = SlaveAddress;                                                                       // Except the address
 
     if ((_slaveAddress > MAX_ADDRESS_VALUE) || (_slaveAddress < 1)) {                                   // If the address is greater than those allowed
         _slaveAddress = DEFAULT_SLAVE_NUMBER;                                                           // I use the default address: 1
     }
 
-    initClass();                                                                                        // I initialize the class and its components
+    return initClass();                                                                                 // I initialize the class and its components
 }
 
-/**********************************************************************************************************************/
-/* Interrupts */
-/* interrupts are not member of class, they are linked as static */
-
-void SUSI2::AddToQueue(PacketT ReceivedData) {
-  if (!MyBuffer[BufferW].B.used)                       // is buffer available?
-  {
-    MyBuffer[BufferW++] = ReceivedData;                     // yes, store data
-    if (BufferW == BUFFER_SIZE) {BufferW = 0;}         // rotate cyrcular pointer
-  }
+void SUSI2::setGap(uint16_t Microseconds) {
+  if (Microseconds < SUSI_GAP_MIN) {Microseconds = SUSI_GAP_MIN;}     // too short gap would split packets
+  GapTime = Microseconds;
+  if (SusiPort<SUSI_SPI>::Bus == this) {setTimer1Gap();}             // before init() (or on object not owning Timer1) only stored, initTimer1() sets it
 }
 
-// Interrupt functions must have "C" linkage!!!
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-void SPI1_IRQHandler(void) __attribute__((interrupt("WCH-Interrupt-fast")));
-/*********************************************************************
- * @fn      SPI1_IRQHandler
- * @brief   This function handles SPI1 received byte.
- * @return  none
- */
-void SPI1_IRQHandler(void)
-{
-  switch (ByteCount) {
-    case 0 :
-      partial.B.cmnd = SPI_I2S_ReceiveData( SPI1 );            // read data to command
-      ByteCount++;
-      break;
-    case 1 :
-      partial.B.arg1 = SPI_I2S_ReceiveData( SPI1 );            // read data to arg1
-      if ( (partial.B.cmnd & 0xF0) == 0x70 )                   // is it 3 byte command? (CV manipulation)
-        {ByteCount++;}                                         // yes, then read next byte
-      else
-        {
-          ByteCount = 0;                                       // reset for next one
-          partial.B.used = 1;                                  // mark as used
-          pointerToSUSI->AddToQueue(partial);                  // add to my queue
-          partial.W = 0;
-        }
-      break;
-    case 2 :
-      partial.B.arg2 = SPI_I2S_ReceiveData( SPI1 );            // read data to arg2 (must be programming command)
-      ByteCount = 0;
-      partial.B.used = 1;                                      // mark as used
-      pointerToSUSI->AddToQueue(partial);                  // add to my queue
-      partial.W = 0;
-      break;
-    default :                                 // some error???
-      SPI_I2S_ReceiveData( SPI1 );            // read data to finish interrupt
-      ByteCount = 0;                          // reset receiver
-      break;
+#ifdef SUSI_USE_BIDI
+/**********************************************************************************************************************/
+/* BiDi answers */
+
+bool SUSI2::setBiDi(uint8_t Command, uint8_t Data) {
+  bool BiDi = ((Command >= 0x01) && (Command <= 0x0F)) || ((Command & 0xF0) == 0x80) || (Command >= 0xE0);   // RCN-601 commands
+  if (!BiDi) {return false;}
+  uint8_t Free = SUSI_BIDI_SLOTS;
+  for (uint8_t i=0; i<SUSI_BIDI_SLOTS; i++) {
+    if (BiDiCommand[i] == Command) {BiDiData[i] = Data; return true;}                  // one byte store, ISR sees old or new answer
+    if ((BiDiCommand[i] == 0) && (Free == SUSI_BIDI_SLOTS)) {Free = i;}
   }
+  if (Free == SUSI_BIDI_SLOTS) {return false;}                                          // table is full
+  BiDiData[Free] = Data;                                                                // data first, then slot is used by ISR
+  BiDiCommand[Free] = Command;
+  return true;
 }
 
-#ifdef __cplusplus
+void SUSI2::clearBiDi(uint8_t Command) {
+  for (uint8_t i=0; i<SUSI_BIDI_SLOTS; i++) {
+    if (BiDiCommand[i] == Command) {BiDiCommand[i] = 0;}
+  }
 }
 #endif
 
-#ifdef  TIM_MODULE_ENABLED
-/*********************************************************************
- * @fn      timerHandler
- * @brief   This function handles TIM1 UP exception (reset of communication).
- * @return  none
- */
-void timerHandler(void)
+/**********************************************************************************************************************/
+/* Receive queue */
+
+#ifndef SUSI_NO_STATS
+SusiStats SUSI2::getStats(void) {
+  SusiStats Stats = Counters;
+  Stats.QueueDrops = getQueueDrops();
+  Stats.QueueHighWater = Queue.highWater();
+#ifndef SUSI_NO_PRIORITY
+  Stats.PriorityHighWater = Priority.highWater();
 #else
-extern "C" {                                        // Interrupt functions must have "C" linkage!!!
-void TIM1_UP_IRQHandler(void) __attribute__((interrupt("WCH-Interrupt-fast")));
-
-/*********************************************************************
- * @fn      TIM1_UP_IRQHandler
- * @brief   This function handles TIM1 UP exception (reset of communication).
- * @return  none
- */
-void TIM1_UP_IRQHandler(void)
+  Stats.PriorityHighWater = 0;
 #endif
-
-{
-    SPI1->CTLR1 |= SPI_NSSInternalSoft_Set ;        // initialize SPI receiver by pulse of SS bit (internal one)
-    SPI1->CTLR1 &= SPI_NSSInternalSoft_Reset;       // bo back to active state
-    TIM_ClearITPendingBit( TIM1, TIM_IT_Update );   // reset interrupt flag
-    ByteCount=0;                                    // reset counter of bytes in packet
-    partial.W=0;                                    // empty partially received data
+  return Stats;
 }
-#ifdef  TIM_MODULE_ENABLED
-#else
-}                                                   // end of extern
 #endif
 
-/**********************************************************************************************************************/
-/* Hardware inits */
-
-void SUSI2::initSPI() {
-  /*
-  R16_SPI_CTLR1             // 0x40013000 SPI Control register1
-
-              0000 0110 1100 0001 = 0x06C1
-                                1: Data sampling starts from the second clock edge.
-                               0: SCK is held low in idle state.
-                              0: Configured as a slave device.
-                          00 0: FHCLK /2;
-                         1: Enable SPI.
-                        1: LSB is transmitted first.
-                      0: NSS is low.
-                     1: Software control of the NSS pins.
-                    1: Receive only, simplex mode.
-                   0: Use 8-bit data length for sending and receiving.
-                 0: Continue to send data from the data register.
-                0: CRC calculation is disabled.
-               0: Disable output, receive only.
-              0: Selection of 2-line bi-directional mode.
-
- 
-
-R16_SPI_CTLR2             // 0x40013004 SPI Control register2
+#ifdef SUSI_COALESCE
+static constexpr uint8_t LatestCommand[SUSI_COALESCE_SLOTS] = {   // command of each coalesced slot (the same order as in AddToQueue)
+  0x24, 0x25, 0x50, 0x51, 0x52, 0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68
+};
 
-              0000 0000 0100 0000
-                                0：Disable Rx buffer DMA.
-                               0：Disable Tx buffer DMA.
-                              0: Disable SS output in Master mode.
-                           0 0 Reserved
-                          0 Error interrupt disable.
-                         1 RX buffer not empty interrupt enable.
-                        0 Tx buffer empty interrupt disable.
-              0000 0000 Reserved
-
- 
-
-R16_SPI_STATR              // 0x40013008 SPI Status register
-
-              Read only - bit 0 = received byte
-
-R16_SPI_DATAR             // 0x4001300C SPI Data register
-
-              received data (read clears bit 0 of STATR)
+uint16_t SUSI2::Waiting(void) {
+  if (WaitHighBinary) {return Queue.size();}                 // pair is open, only queue is decoded (see PopPacket)
+  uint16_t Count = Queue.size();
+#ifndef SUSI_NO_PRIORITY
+  Count += Priority.size();
+#endif
+  for (uint8_t i=0; i<SUSI_COALESCE_SLOTS; i++) {Count += LatestPending[i];}
+  return Count;
+}
 
+bool SUSI2::PopLatest(SusiSlot& Slot) {
+  for (uint8_t i=0; i<SUSI_COALESCE_SLOTS; i++) {
+    if (!LatestPending[i]) {continue;}
+    LatestPending[i] = 0;                                    // clear first - newer value written by interrupt sets it again
+    Slot.Packet.W = 0;
+    Slot.Packet.B.cmnd = LatestCommand[i];
+    Slot.Packet.B.arg1 = LatestArg[i];
+#ifndef SUSI_NO_TIMESTAMPS
+    Slot.Time = LatestTime[i];
+#endif
+    return true;
+  }
+  return false;
+}
+#endif
 
-SPI1->CTLR1 |= CTLR1_SPE_Set;
+/**********************************************************************************************************************/
+/* Decoded state mirror */
+
+bool SUSI2::UpdateState(uint8_t Index, uint8_t Value) {
+  uint32_t KnownBit = (uint32_t)1 << Index;
+  bool Changed = ((Mirror[Index] != Value) || (!(MirrorKnown & KnownBit)));   // first value is always change
+  Mirror[Index] = Value;
+  MirrorKnown |= KnownBit;
+  return (Changed || (!ChangeOnly));
+}
 
- */
+void SUSI2::notifyChangesOnly(bool Enable) {
+  ChangeOnly = Enable;
+}
 
-    SPI_InitTypeDef SPI_InitStructure={0};
+void SUSI2::UpdateBinaryState(uint8_t Command, bool State) {
+  if (State) {BinaryStates[Command >> 3] |= (1 << (Command & 0x07));}
+        else {BinaryStates[Command >> 3] &= (uint8_t)(~(1 << (Command & 0x07)));}
+}
 
-    RCC_APB2PeriphClockCmd(  RCC_APB2Periph_SPI1, ENABLE ); // do not forget clock
+void SUSI2::UpdateBinaryStates(bool State) {
+  for (uint8_t i=0; i<sizeof(BinaryStates); i++) {BinaryStates[i] = State ? 0xFF : 0x00;}
+}
 
-    pinMode(SPI_SCK,INPUT); // SUSI data
-    pinMode(SPI_MOSI,INPUT); // SUSI clock
-    //pinMode(SPI_MISO,GPIO_Mode_AF_PP);    // not used
-    //pinMode(SPI_CS,INPUT);     // not used
+bool SUSI2::getBinaryState(uint8_t Command) {
+  if ((Command < 1) || (Command > 127)) {return false;}
+  return (BinaryStates[Command >> 3] & (1 << (Command & 0x07))) != 0;
+}
 
+bool SUSI2::getFunction(uint8_t Function) {
+  if (Function == 0) {return (Mirror[MIRROR_FN + SUSI_FN_0_4] & SUSI_FN_BIT_00) != 0;}                 // F0 is bit 4 of first group
+  if (Function < 5) {return (Mirror[MIRROR_FN + SUSI_FN_0_4] & (1 << (Function - 1))) != 0;}           // F1 - F4 are bits 0 - 3
+  if (Function > 68) {return false;}
+  Function -= 5;                                                                                        // F5 - F68 are 8 bits per group
+  return (Mirror[MIRROR_FN + SUSI_FN_5_12 + (Function >> 3)] & (1 << (Function & 0x07))) != 0;
+}
 
+uint8_t SUSI2::getFunctionGroup(SUSI_FN_GROUP Group) {
+  if (Group > SUSI_FN_61_68) {return 0;}
+  return Mirror[MIRROR_FN + Group];
+}
 
-#define SPI_FirstBit_LSB  ((uint16_t)0x0080)      // not defined in default header
+bool SUSI2::getAux(uint8_t Aux) {
+  if ((Aux < 1) || (Aux > 32)) {return false;}
+  Aux -= 1;
+  return (Mirror[MIRROR_AUX + (Aux >> 3)] & (1 << (Aux & 0x07))) != 0;
+}
 
-// SPI parameters to fit SUSI requirements
-    SPI_InitStructure.SPI_Direction = SPI_Direction_2Lines_RxOnly;
-    SPI_InitStructure.SPI_Mode = SPI_Mode_Slave;
-    SPI_InitStructure.SPI_DataSize = SPI_DataSize_8b;
-    SPI_InitStructure.SPI_CPOL = SPI_CPOL_Low;
-    SPI_InitStructure.SPI_CPHA = SPI_CPHA_2Edge;
-    SPI_InitStructure.SPI_NSS = SPI_NSS_Soft;
-    SPI_InitStructure.SPI_BaudRatePrescaler = SPI_BaudRatePrescaler_256;
-    SPI_InitStructure.SPI_FirstBit = SPI_FirstBit_LSB;
-    SPI_InitStructure.SPI_CRCPolynomial = 7;
-    SPI_Init( SPI1, &SPI_InitStructure );
+uint8_t SUSI2::getAuxGroup(SUSI_AUX_GROUP Group) {
+  if (Group > SUSI_AUX_25_32) {return 0;}
+  return Mirror[MIRROR_AUX + Group];
+}
 
-// Enable interrupt on interrupt controller
-    NVIC_EnableIRQ(SPI1_IRQn);
+uint8_t SUSI2::getRealSpeed(void) {
+  return Mirror[MIRROR_REAL_SPEED] & 0x7F;
+}
 
-// set interrupt for new packet received
-    SPI_I2S_ITConfig( SPI1, SPI_I2S_IT_RXNE , ENABLE );     //RX buffer not empty interrupt enable bit. Used to generate an interrupt request when the RXNE flag is set. 
+SUSI_DIRECTION SUSI2::getRealDirection(void) {
+  return (Mirror[MIRROR_REAL_SPEED] & 0x80) ? SUSI_DIR_FWD : SUSI_DIR_REV;
+}
 
-// Enable SPI
-    SPI_Cmd( SPI1, ENABLE );
+uint8_t SUSI2::getRequestSpeed(void) {
+  return Mirror[MIRROR_REQUEST_SPEED] & 0x7F;
+}
 
+SUSI_DIRECTION SUSI2::getRequestDirection(void) {
+  return (Mirror[MIRROR_REQUEST_SPEED] & 0x80) ? SUSI_DIR_FWD : SUSI_DIR_REV;
+}
 
-  //SPI_CTLR1 = 0x06C1;
+uint8_t SUSI2::getDCCSpeed(void) {
+  return Mirror[MIRROR_DCC_SPEED] & 0x7F;
 }
 
-void SUSI2::initTimer1() {     // Timer 1 in "slave" mode.
+SUSI_DIRECTION SUSI2::getDCCDirection(void) {
+  return (Mirror[MIRROR_DCC_SPEED] & 0x80) ? SUSI_DIR_FWD : SUSI_DIR_REV;
+}
 
-    // the trick is, that timer receive "reset" every falling edge of ETR pin, and ETR pin is shared with SUSI clock.
-    // it mean, timer count 7 miliseconds from last click. After this it reset receiver.
-    // It requiere good configuration of slave mode register. I did not found it in default HAL setup, then I decided to use direct hex values. Sorry
+uint8_t SUSI2::getAnalogFunction(SUSI_AN_GROUP Group) {
+  if (Group > SUSI_AN_FN_8) {return 0;}
+  return Mirror[MIRROR_ANALOG + Group];
+}
 
-    //pinMode(SPI_SCK,INPUT); // SUSI data - already done in SPI
+/**********************************************************************************************************************/
+/* Command dispatch table */
+// Every command byte 0x00 - 0x7F has one entry: handler + parameter. Commands of one family (function groups, AUXs,
+// analog functions, speeds) share the same handler, parameter selects the group. Commands 0x80 - 0xFF are reserved for BiDi.
+
+#define CMD_NONE  {H_UNKNOWN, 0}
+
+static constexpr SusiCommand CommandTable[128] = {
+/* 0x00 */  {H_NOP, 0},          CMD_NONE,             CMD_NONE,             CMD_NONE,
+/* 0x04 */  CMD_NONE,            CMD_NONE,             CMD_NONE,             CMD_NONE,
+/* 0x08 */  CMD_NONE,            CMD_NONE,             CMD_NONE,             CMD_NONE,
+/* 0x0C */  CMD_NONE,            CMD_NONE,             CMD_NONE,             CMD_NONE,
+/* 0x10 */  CMD_NONE,            CMD_NONE,             CMD_NONE,             CMD_NONE,
+/* 0x14 */  CMD_NONE,            CMD_NONE,             CMD_NONE,             CMD_NONE,
+/* 0x18 */  CMD_NONE,            CMD_NONE,             CMD_NONE,             CMD_NONE,
+/* 0x1C */  CMD_NONE,            CMD_NONE,             CMD_NONE,             CMD_NONE,
+/* 0x20 */  CMD_NONE,            {H_TRIGGER, 0},       CMD_NONE,             {H_CURRENT, 0},
+/* 0x24 */  {H_SPEED, MIRROR_REAL_SPEED}, {H_SPEED, MIRROR_REQUEST_SPEED}, {H_LOAD, 0}, CMD_NONE,
+/* 0x28 */  {H_ANALOG, SUSI_AN_FN_1}, {H_ANALOG, SUSI_AN_FN_2}, {H_ANALOG, SUSI_AN_FN_3}, {H_ANALOG, SUSI_AN_FN_4},
+/* 0x2C */  {H_ANALOG, SUSI_AN_FN_5}, {H_ANALOG, SUSI_AN_FN_6}, {H_ANALOG, SUSI_AN_FN_7}, {H_ANALOG, SUSI_AN_FN_8},
+/* 0x30 */  {H_ANALOG_DIRECT, 1}, {H_ANALOG_DIRECT, 2}, CMD_NONE,          CMD_NONE,
+/* 0x34 */  CMD_NONE,            CMD_NONE,             CMD_NONE,             CMD_NONE,
+/* 0x38 */  CMD_NONE,            CMD_NONE,             CMD_NONE,             CMD_NONE,
+/* 0x3C */  CMD_NONE,            CMD_NONE,             CMD_NONE,             CMD_NONE,
+/* 0x40 */  {H_AUX, SUSI_AUX_1_8}, {H_AUX, SUSI_AUX_9_16}, {H_AUX, SUSI_AUX_17_24}, {H_AUX, SUSI_AUX_25_32},
+/* 0x44 */  CMD_NONE,            CMD_NONE,             CMD_NONE,             CMD_NONE,
+/* 0x48 */  CMD_NONE,            CMD_NONE,             CMD_NONE,             CMD_NONE,
+/* 0x4C */  CMD_NONE,            CMD_NONE,             CMD_NONE,             CMD_NONE,
+/* 0x50 */  {H_SPEED, MIRROR_REAL_SPEED}, {H_SPEED, MIRROR_REQUEST_SPEED}, {H_SPEED, MIRROR_DCC_SPEED}, CMD_NONE,
+/* 0x54 */  CMD_NONE,            CMD_NONE,             CMD_NONE,             CMD_NONE,
+/* 0x58 */  CMD_NONE,            CMD_NONE,             CMD_NONE,             CMD_NONE,
+/* 0x5C */  CMD_NONE,            CMD_NONE,             {H_ADDRESS_LOW, 0},   {H_ADDRESS_HIGH, 0},
+/* 0x60 */  {H_FUNC, SUSI_FN_0_4}, {H_FUNC, SUSI_FN_5_12}, {H_FUNC, SUSI_FN_13_20}, {H_FUNC, SUSI_FN_21_28},
+/* 0x64 */  {H_FUNC, SUSI_FN_29_36}, {H_FUNC, SUSI_FN_37_44}, {H_FUNC, SUSI_FN_45_52}, {H_FUNC, SUSI_FN_53_60},
+/* 0x68 */  {H_FUNC, SUSI_FN_61_68}, CMD_NONE,         CMD_NONE,             CMD_NONE,
+/* 0x6C */  {H_MODULE_CONTROL, 0}, {H_BINARY_SHORT, 0}, {H_BINARY_LOW, 0},   {H_BINARY_HIGH, 0},
+/* 0x70 */  CMD_NONE,            CMD_NONE,             CMD_NONE,             CMD_NONE,
+/* 0x74 */  CMD_NONE,            CMD_NONE,             CMD_NONE,             {H_CV_CHECK, 0},
+/* 0x78 */  CMD_NONE,            CMD_NONE,             CMD_NONE,             {H_CV_BIT, 0},
+/* 0x7C */  {H_CV_RESET, 0},     CMD_NONE,             CMD_NONE,             {H_CV_WRITE, 0}
+};
+
+static constexpr uint8_t HandlerClass[] = {                  // statistics class (and SUSI_FEATURES bit) of each SusiHandler (same order as enum)
+  0,                  SUSI_STAT_CONTROL,  SUSI_STAT_MOTION,   SUSI_STAT_MOTION,     // H_UNKNOWN (counted separately), H_NOP, H_TRIGGER, H_CURRENT
+  SUSI_STAT_MOTION,   SUSI_STAT_MOTION,   SUSI_STAT_ANALOG,   SUSI_STAT_ANALOG,     // H_SPEED, H_LOAD, H_ANALOG, H_ANALOG_DIRECT
+  SUSI_STAT_FUNCTION, SUSI_STAT_CONTROL,  SUSI_STAT_CONTROL,  SUSI_STAT_FUNCTION,   // H_AUX, H_ADDRESS_LOW, H_ADDRESS_HIGH, H_FUNC
+  SUSI_STAT_CONTROL,  SUSI_STAT_BINARY,   SUSI_STAT_BINARY,   SUSI_STAT_BINARY,     // H_MODULE_CONTROL, H_BINARY_SHORT, H_BINARY_LOW, H_BINARY_HIGH
+  SUSI_STAT_CV,       SUSI_STAT_CV,       SUSI_STAT_CV,       SUSI_STAT_CV,         // H_CV_CHECK, H_CV_BIT, H_CV_RESET, H_CV_WRITE
+  SUSI_STAT_CONTROL                                                                 // H_BIDI
+};
+static_assert(sizeof(HandlerClass) == H_BIDI + 1, "HandlerClass must follow SusiHandler");
+
+// speed callbacks in order of MIRROR_REAL_SPEED, MIRROR_REQUEST_SPEED, MIRROR_DCC_SPEED (weak - can be NULL)
+static void (* const SpeedCallback[3])(uint8_t Speed, SUSI_DIRECTION Dir) = {notifySusiRealSpeed, notifySusiRequestSpeed, notifySusiDCCSpeed};
 
+/**********************************************************************************************************************/
+/* Command filter */
+// Filter is checked in interrupt, before packet is stored to queue. Bit per command 0x00 - 0xFF, 1 = command is queued.
+// Pairs (0x5E/0x5F, 0x6E/0x6F) and CV manipulation (0x70 - 0x7F) are always queued. Commands of families not in SUSI_FEATURES are never queued.
 
-#ifdef  TIM_MODULE_ENABLED
-    myTimer.setOverflow(7000, MICROSEC_FORMAT); // 7 milisecond reset rate        This part is for HardwareTimer compatibility only
-    myTimer.attachInterrupt(timerHandler);                                     // This part is for HardwareTimer compatibility only
+void SUSI2::subscribeAll(void) {
+#if SUSI_FEATURES == SUSI_FEATURE_ALL
+  for (uint8_t i=0; i<8; i++) {CommandFilter[i] = 0xFFFFFFFF;}
 #else
-    RCC_APB2PeriphClockCmd(RCC_APB2Periph_TIM1, ENABLE );   // enable clock for timer
+  subscribe(0x00, 0xFF);                                     // only selected features
 #endif
+}
 
-//R16_TIM1_CTLR1  Control register 1
-// 0000 0000 0000 0100 = 0x0004
-//                   0 - Enables the counter. -> this is enabled afterwards by TIM_Cmd
-//                  0 - 0: UEV is allowed. update (UEV) events are generated by any of the following events: -Counter overflow/underflow ..
-//                 1 - 1: If an update interrupt is enabled, only an update interrupt is generated if the counter overflows/underflows. 
-//                0 - 0: The counter does not stop when the next update event occurs.  --> that is questionable, I nave nultiple resets every 7 ms. It can be useful  can be only one.
-//              0 - 0: the counter's counting mode is incremental. 
-//            00 - 00: Edge-aligned mode. The counter counts up or down based on the direction bit (DIR). 
-//           0 - 0: Auto Reload Value Register (ATRLR) is disabled. 
-//        00 - 00: Tdts=Tck_int (no time divider 1:1)
-//   00 00 - reserved
-//  0 - 0: The capture value is the value of the actual counter 
-// 0 - 0: Disable the indication function
-
-// R16_TIM1_SMCFGR - Slave mode control register 
-// 1000 0000 0111 0100 = 0x8074
-//                 100 - 100: reset mode, where the rising edge of the trigger input (TRGI) will initialize the counter and generate a signal to update the registers. 
-//                0 - reserved
-//            111 - 111: External trigger input (ETRF). 
-//           0 - 0: Does not function. 
-//      0000 - 0000: No externally triggered filtering
-//   00 - 00: Prescaler off. 
-//  0 - 0: Disable external clock mode 2. 
-// 1 - 1: Invert ETR, low or falling edge active; 
-
-// Timing constant calculation:
-// Timer update is generated, when repetation counter reach requested number of repetations.
-// In reality prescaler and repetation counter starts with 0, it mean, we must increment them (+1) to be on usual mathematic.
-// Calculation here is for 48 MHz clock only, no any clever automatic calculation.
-// Calculation formula can be written like this:
-// Prescaler * ATRLR * RepetitionCounter / SystemClock
-// Do not forget, that prescaler is (PSC + 1) and RepetitionCounter is (RPTCR + 1)
-//
-// In our case: ((PSC + 1) * ATRLR * (RPTCR + 1)) / System clock
-// ((1 + 1) * 56 000 * (2+1)) / 48 000 000 = (2 * 56 000 * 3) / 48 000 000 = 336 000 / 48 000 000 = 0,007 seconds = 7 ms.
-
-    TIM1->CTLR1 = 0x0004;    // URS=1 interupt on overload...
-    TIM1->SMCFGR = 0x8074;  // inverted trigger, no prescaler, no ETF, no MSM, Trigger Selection FS = external ETRF (7), SMS = reset mode (4)
-    TIM1->PSC = 1;          // prescaler = 1 -> 48 MHz / (PSC+1) = 24 MHz / 56000 = 428.6 Hz / (RTPCR+1) = 142.8 Hz -> 7 ms.
-    TIM1->RPTCR = 2;         // Repetition Counter (postscaler)  Updata_time = psc*arr*RepetitionCounter/system
-    TIM1->ATRLR = 56000;
-    TIM_Cmd( TIM1, ENABLE );
-
-    TIM_ClearITPendingBit( TIM1, TIM_IT_Update );   // clear potential interrupt flag from the past
-
-    NVIC_EnableIRQ(TIM1_UP_IRQn);                   // enable Timer 1 update unterrupt on controller
-
-    TIM_ITConfig(TIM1, TIM_IT_Update, ENABLE);      // enable timer updating event in timer config
-
+void SUSI2::unsubscribeAll(void) {
+  for (uint8_t i=0; i<8; i++) {CommandFilter[i] = 0;}
+  subscribe(0x5E, 0x5F);                                     // module address pair
+  subscribe(0x6E, 0x6F);                                     // binary states long form pair
+  subscribe(0x70, 0x7F);                                     // CV manipulation
 }
 
-/**********************************************************************************************************************/
-/* ACK pulse as hardware */
-void SUSI2::SendACK() {
-  pinMode(SPI_MOSI,OUTPUT_OD);  // change pin to output, with open drain
-  digitalWrite(SPI_MOSI, LOW);  // set it to low
-  //delay(2);                     // ch32 does not look for "half" milisecond, so delay(2) mean more than 1, less than 2
-  delayMicroseconds(1500);       // seems, that delayMicrosecond will fit
-  pinMode(SPI_MOSI,INPUT);      // change pin back to input
-  
+void SUSI2::subscribe(uint8_t FirstCommand, uint8_t LastCommand) {
+  for (uint16_t Command = FirstCommand; Command <= LastCommand; Command++) {
+#if SUSI_FEATURES != SUSI_FEATURE_ALL
+    if (!(Command & 0x80)) {
+      uint8_t Handler = CommandTable[Command].Handler;
+      if ((Handler != H_UNKNOWN) && (!(SUSI_FEATURES & (1 << HandlerClass[Handler])))) {continue;}   // decoder is not compiled in
+    }
+#endif
+    CommandFilter[Command >> 5] |= ((uint32_t)1 << (Command & 0x1F));
+  }
 }
 
+void SUSI2::subscribeLinked(void) {
+  if ((notifySusiRawMessage) || (notifySusiRawMessage3b)) {subscribeAll(); return;}   // raw messages want to see everything
+  unsubscribeAll();
+  for (uint16_t Command = 0; Command < 256; Command++) {
+    SusiCommand Entry = CMD_NONE;
+    if (!(Command & 0x80)) {Entry = CommandTable[Command];}
+    bool Linked;
+    switch (Entry.Handler) {
+      case H_NOP:             Linked = (notifySusiNoOperation != 0); break;
+      case H_TRIGGER:         Linked = (notifySusiTriggerPulse != 0); break;
+      case H_CURRENT:         Linked = (notifySusiMotorCurrent != 0); break;
+      case H_SPEED:           Linked = (SpeedCallback[Entry.Param - MIRROR_REAL_SPEED] != 0); break;
+      case H_LOAD:            Linked = (notifySusiMotorLoad != 0); break;
+      case H_ANALOG:          Linked = (notifySusiAnalogFunction != 0); break;
+      case H_ANALOG_DIRECT:   Linked = (notifySusiAnalogDirectCommand != 0); break;
+      case H_AUX:             Linked = (notifySusiAux != 0); break;
+      case H_FUNC:            Linked = (notifySusiFunc != 0); break;
+      case H_MODULE_CONTROL:  Linked = (notifySusiControllModule != 0); break;
+      case H_BINARY_SHORT:    Linked = ((notifySusiBinaryState != 0) || (notifySusiBinaryStateBroadcast != 0)); break;
+      case H_UNKNOWN:         Linked = (notifySusiUnknownMessage != 0); break;
+      default:                Linked = false; break;            // always queued ones are already set
+    }
+    if (Linked) {subscribe(Command, Command);}
+  }
+}
 
 /**********************************************************************************************************************/
 /* Message processor */
+// Dispatch of decoded packets to callbacks is template (SUSI2Dispatch.h), weak callbacks are one instance of it.
 
 int8_t SUSI2::process(void) {
-  int8_t ResponseStatus = 0;
-  if (MyBuffer[BufferR].B.used) {ResponseStatus = 1;}        // at minimum one in queue
-  while (MyBuffer[BufferR].B.used)                           // are data in buffer available?
-  {
-    if (WaitHighBinary==1) {                                    // pair function 0x6F must follow 0x6E
-      if (MyBuffer[BufferR].B.cmnd != 0x6F) {
-        WaitHighBinary=0;                                    // does not follow, cancel
-      }
+  SusiWeakCallbacks Weak;
+  return process(Weak);
+}
+
+uint16_t SUSI2::process(uint8_t MaxPackets, uint16_t MaxMicros) {
+  SusiWeakCallbacks Weak;
+  return process(Weak, MaxPackets, MaxMicros);
+}
+
+int8_t SUSI2::idle(void) {
+  waitForPacket();                                           // sleep, when there is nothing to do
+  return process();
+}
+
+bool SUSI2::poll(SusiEvent& Event) {
+  SusiEventCallbacks Collect(Event);
+  SusiSlot Slot;
+#ifdef SUSI_USE_DMA
+  DrainReceiver();                                           // tail of burst, DMA interrupt did not come for it
+#endif
+  while (PopPacket(Slot)) {                                  // packets without event (first of pair, CV, unchanged state) are skipped
+#ifndef SUSI_NO_TIMESTAMPS
+    LastPacketTime = Slot.Time;
+#endif
+    DecodePacket(Slot.Packet, Collect);
+    if (Collect.Ready) {
+#ifndef SUSI_NO_TIMESTAMPS
+      Event.Time = Slot.Time;
+#endif
+      return true;
     }
-    if (WaitHighBinary==2) {                                    // pair function 0x5F must follow 0x5E
-      if (MyBuffer[BufferR].B.cmnd != 0x5F) {
-        WaitHighBinary=0;                                    // does not follow, cancel
-      }
+  }
+#ifdef SUSI_CV_CACHE_SIZE
+  CacheIdle();
+#endif
+  return false;
+}
+
+SusiCommand SUSI2::DecodeStart(uint8_t Command) {
+  SusiCommand Entry = CMD_NONE;
+  if (!(Command & 0x80)) {Entry = CommandTable[Command];}   // upper half is reserved for BiDi, not in table
+#ifdef SUSI_USE_BIDI
+  if (Entry.Handler == H_UNKNOWN) {
+    for (uint8_t i=0; i<SUSI_BIDI_SLOTS; i++) {
+      if ((BiDiCommand[i] == Command) && (Command != 0)) {Entry.Handler = H_BIDI; break;}   // answered by interrupt, it is known one
     }
-    if ((notifySusiRawMessage) && ((MyBuffer[BufferR].B.cmnd & 0xF0) != 0x70)) {
-        notifySusiRawMessage(MyBuffer[BufferR].B.cmnd, MyBuffer[BufferR].B.arg1);
+  }
+#endif
+#ifndef SUSI_NO_STATS
+  if (Entry.Handler != H_UNKNOWN) {SUSI_COUNT(Packets[HandlerClass[Entry.Handler]]);}
+#endif
+
+  if (WaitHighBinary==1) {                                    // pair function 0x6F must follow 0x6E
+    if (Command != 0x6F) {
+      WaitHighBinary=0;                                    // does not follow, cancel
     }
-    if ((notifySusiRawMessage3b) && ((MyBuffer[BufferR].B.cmnd & 0xF0) == 0x70)) {
-        notifySusiRawMessage3b(MyBuffer[BufferR].B.cmnd, MyBuffer[BufferR].B.arg1, MyBuffer[BufferR].B.arg2);
+  }
+  if (WaitHighBinary==2) {                                    // pair function 0x5F must follow 0x5E
+    if (Command != 0x5F) {
+      WaitHighBinary=0;                                    // does not follow, cancel
     }
+  }
+  return Entry;
+}
 
-    switch (MyBuffer[BufferR].B.cmnd) {
-      case 0x60:
-        /*Function group 1 : 0110-0000 (0x60 = 96) 0 0 0 F0 - F4 F3 F2 F1*/
-        if (notifySusiFunc) {
-          notifySusiFunc(SUSI_FN_0_4, MyBuffer[BufferR].B.arg1);
-        }
-        break;
-      case 0x61:
-        /*Function group 2 : 0110-0001 (0x61 = 97) F12 F11 F10 F9 - F8 F7 F6 F5*/
-        if (notifySusiFunc) {
-          notifySusiFunc(SUSI_FN_5_12, MyBuffer[BufferR].B.arg1);
-        }
-        break;
-      case 0x62:
-        /*Function group 3 : 0110-0010 (0x62 = 98) F20 F19 F18 F17 - F16 F15 F14 F13*/
-        if (notifySusiFunc) {
-          notifySusiFunc(SUSI_FN_13_20, MyBuffer[BufferR].B.arg1);
-        }
-        break;
-      case 0x63:
-        /*Function group 4 : 0110-0011 (0x63 = 99) F28 F27 F26 F25 - F24 F23 F22 F21*/
-        if (notifySusiFunc) {
-          notifySusiFunc(SUSI_FN_21_28, MyBuffer[BufferR].B.arg1);
-        }
-        break;
-      case 0x64:
-        /*Function group 5 : 0110-0100 (0x64 = 100) F36 F35 F34 F33 - F32 F31 F30 F29*/
-        if (notifySusiFunc) {
-          notifySusiFunc(SUSI_FN_29_36, MyBuffer[BufferR].B.arg1);
-        }
-        break;
-      case 0x65:
-        /*Function group 6 : 0110-0101 (0x65 = 101) F44 F43 F42 F41 - F40 F39 F38 F37*/
-        if (notifySusiFunc) {
-          notifySusiFunc(SUSI_FN_37_44, MyBuffer[BufferR].B.arg1);
-        }
-        break;
-      case 0x66:
-        /*Function group 7 : 0110-0110 (0x66 = 102) F52 F51 F50 F49 - F48 F47 F46 F45*/
-        if (notifySusiFunc) {
-          notifySusiFunc(SUSI_FN_45_52, MyBuffer[BufferR].B.arg1);
-        }
-        break;
-      case 0x67:
-        /*Function group 8 : 0110-0111 (0x67 = 103) F60 F59 F58 F57 - F56 F55 F54 F53*/
-        if (notifySusiFunc) {
-          notifySusiFunc(SUSI_FN_53_60, MyBuffer[BufferR].B.arg1);
-        }
-        break;
-      case 0x68:
-        /*Function group 9 : 0110-1000 (0x68 = 104) F68 F67 F66 F65 - F64 F63 F62 F61*/
-        if (notifySusiFunc) {
-          notifySusiFunc(SUSI_FN_61_68, MyBuffer[BufferR].B.arg1);
-        }
-        break;
-      case 0x6D:
-        /*Binary states short form : 0110-1101 (0x6D = 109) D L6 L5 L4 - L3 L2 L1 L0
-            D = 0 means function L switched off, D = 1 switched on
-            L = function number 1 ... 127
-            L = 0 (broadcast) switches all functions 1 to 127 off (D = 0) or on (D = 1)*/
-        if (notifySusiBinaryState) {
-            if ((MyBuffer[BufferR].B.arg1 & 0x7F) == 0) {      // L = 0 ?
-                // Broadcast to all functions
-                if (MyBuffer[BufferR].B.arg1 & 0x80) {	// D = 0 ?? deactivate all
-                    for (int i = 1; i < 128; i++) {
-                        notifySusiBinaryState(i, 0);
-                    }
-                }
-                else {				// D = 1 activate all
-                    for (int i = 1; i < 128; i++) {
-                        notifySusiBinaryState(i, 1);
-                    }
-                }
-            }
-            else {
-                // Command for one function
-                notifySusiBinaryState(MyBuffer[BufferR].B.arg1 & 0x7F, (MyBuffer[BufferR].B.arg1 & 0x80) != 0);
-                                       // ^^ Function number             ^^ Function state
-            }
-        }
-        break;
-      case 0x6E:  // && 0x6F
-        /*Binary states long form low byte : 0110-1110 (0x6E = 110) D L6 L5 L4 - L3 L2 L1 L0
-            The Binary states long form commands are always sent as a pair. This command is sent before
-            the binary state long form high byte. If the two commands do not follow each other directly, they
-            must be ignored.
-            D = 0 means binary state L switched off, D = 1 "switched on"
-            L = low-order bits of binary state number 1 ... 32767
-
-            Binary states long form high byte : 0110-1111 (0x6F = 111) H7 H6 H5 H4 - H3 H2 H1 H0
-            The Binary states long form commands are always sent as a pair. This command is sent after
-            the binary state long form low byte. If the two commands do not follow each other directly, they must
-            be ignored. Only this command leads to the execution of the complete command.
-            H = high-order bits of the binary state number high 1 ... 32767
-            H and L = 0 (broadcast) switches all 32767 available binary states off (D = 0) or on (D = 1)*/
-        LowBinary = MyBuffer[BufferR].B.arg1;   // copy low byte for future
-        WaitHighBinary = 1;                     // set waiting flag
-        break;
-      case 0x6F:  // && 0x6E
-        if (WaitHighBinary == 1) {                   // only if previous one was 0x6E
-          WaitHighBinary = 0;                   // remove waiting flag
-          uint16_t BAddress = MyBuffer[BufferR].B.arg1;
-          BAddress = BAddress << 7;
-          BAddress |= (LowBinary & 0x7F);
-          if (notifySusiBinaryStateL) {
-            notifySusiBinaryStateL(BAddress, (LowBinary & 0x80) != 0);
-          }
-        }
-        break;
-      case 0x40:
-        /*Direct command 1 : 0100-0000 (0x40 = 64) X8 X7 X6 X5 - X4 X3 X2 X1
-            The direct commands are used for direct control of outputs and other functions after
-            interpreting the function (mapping) table in the Host. A bit = 1 means the corresponding output is
-            switched on.*/
-        if (notifySusiAux) {
-          notifySusiFunc(SUSI_AUX_1_8, MyBuffer[BufferR].B.arg1);
-        }
-        break;
-      case 0x41:
-        /*Direct command 2 : 0100-0001 (0x41 = 65) X16 X15 X14 X13 - X12 X11 X10 X9 */
-        if (notifySusiAux) {
-          notifySusiFunc(SUSI_AUX_9_16, MyBuffer[BufferR].B.arg1);
-        }
-        break;
-      case 0x42:
-        /*Direct command 3 : 0100-0010 (0x42 = 66) X24 X23 X22 X21 – X20 X19 X18 X17 */
-        if (notifySusiAux) {
-          notifySusiFunc(SUSI_AUX_17_24, MyBuffer[BufferR].B.arg1);
-        }
-        break;
-      case 0x43:
-        /*Direct command 4 : 0100-0011 (0x43 = 67) X32 X31 X30 X29 - X28 X27 X26 X25 */
-        if (notifySusiAux) {
-          notifySusiFunc(SUSI_AUX_25_32, MyBuffer[BufferR].B.arg1);
-        }
-        break;
-      case 0x21:
-        /*Trigger pulse : 0010-0001 (0x21 = 33) 0 0 0 0 - 0 0 0 1 
-          The command is used for synchronization of a steam impulse. It is sent once per steam pulse. 
-          Bits 1 to 7 are reserved for future applications.*/
-        if (notifySusiTriggerPulse) {
-          notifySusiTriggerPulse(MyBuffer[BufferR].B.arg1);
-        }
-        break;
-      case 0x23:
-        /*Current : 0010-0011 (0x23 = 35) S7 S6 S5 S4 - S3 S2 S1 S0
-          Current consumed by the motor. The value has a range from -128 to 127, is transmitted in 2's 
-          complement and is calibrated by a manufacturer specific CV in the locomotive decoder. Negative 
-          values mean regeneration as it is possible with modern electric locomotives. */
-        if (notifySusiMotorCurrent) {
-          notifySusiMotorCurrent(static_cast<int8_t>(MyBuffer[BufferR].B.arg1));
-        }
-        break;
-      case 0x24:
-      case 0x50:
-        /*Locomotive actual speed step : 0010-0100 (0x24 = 36) R G6 G5 G4 - G3 G2 G1 G0
-          The speed step and direction correspond to the real state of the motor. The transmitted G value 
-          is the Vmax of the model normalized to 0…127. G = 0 means the locomotive is stationary, G = 1 ... 
-          127 is the normalized speed, R = direction of travel with R = 0 for reverse and R = 1 for forward. 
-          This and the following command are not recommended for new implementations. SUSI-Modules 
-          should evaluate commands 0x50 to 0x52 if possible. Hosts that use deviating and/or different 
-          implementations for commands 0x24 and 0x25 for compatibility with existing products are compliant 
-          with the standard */
-        if (notifySusiRealSpeed) {
-          if (MyBuffer[BufferR].B.arg1 & 0x80) {
-            notifySusiRealSpeed(MyBuffer[BufferR].B.arg1 & 0x7F,SUSI_DIR_FWD);
-          }
-          else {
-            notifySusiRealSpeed(MyBuffer[BufferR].B.arg1,SUSI_DIR_REV);
-          }
-        }
-        break;
-      case 0x25:
-      case 0x51:
-        /*Locomotive target speed step : 0010-0101 (0x25 = 37) R G6 G5 G4 - G3 G2 G1 G0
-          Received speed level of the "Host" normalized to 127 speed levels. G = 0 means locomotive 
-          should stop, G = 1 ... 127 is the normalized speed R = direction of travel with R = 0 for reverse and 
-          R = 1 for forward.*/
-        if (notifySusiRequestSpeed) {
-          if (MyBuffer[BufferR].B.arg1 & 0x80) {
-            notifySusiRequestSpeed(MyBuffer[BufferR].B.arg1 & 0x7F,SUSI_DIR_FWD);
-          }
-          else {
-            notifySusiRequestSpeed(MyBuffer[BufferR].B.arg1,SUSI_DIR_REV);
-          }
-        }
-        break;
-      case 0x26:
-        /*Load control : 0010-0110 (0x26 = 38) P7 P6 P5 P4 - P3 P2 P1 P0
-          The load state can be detected by motor voltage, current or power. 0 = no load, 127 = 
-          maximum load. Negative values are also possible, which are transmitted in 2's complement. This 
-          mean less load than driving on flat surface. */
-        if (notifySusiMotorLoad) {
-          notifySusiMotorLoad(static_cast<int8_t>(MyBuffer[BufferR].B.arg1));
-        }
-        break;
-      //case 0x50  see upwards with 0x24
-      //case 0x51  see upwards with 0x25
-      case 0x52:
-        /*DCC speed step : 0101-0010 (0x52 = 82) R G6 G5 G4 - G3 G2 G1 G0
-          This value is only normalized from 14 or 28 speed steps to 127 speed steps if necessary. There 
-          is no adjustment by any CVs.*/
-        if (notifySusiDCCSpeed) {
-          if (MyBuffer[BufferR].B.arg1 & 0x80) {
-            notifySusiDCCSpeed(MyBuffer[BufferR].B.arg1 & 0x7F,SUSI_DIR_FWD);
-          }
-          else {
-            notifySusiDCCSpeed(MyBuffer[BufferR].B.arg1,SUSI_DIR_REV);
-          }
-        }
-        break;
-      case 0x28:
-        /*Analog function group 1 : 0010-1xxx (0x28 = 40 to 0x2F = 47) A7 A6 A5 A4 - A3 A2 A1 A0
-          The eight commands of this group allow the transmission of eight different analog values in 
-          digital mode.*/
-        if (notifySusiAnalogFunction) {
-          notifySusiAnalogFunction(SUSI_AN_FN_1,MyBuffer[BufferR].B.arg1);
-        }
-        break;
-      case 0x29:
-        /*Analog function group 1 : 0010-1xxx (0x28 = 40 to 0x2F = 47) A7 A6 A5 A4 - A3 A2 A1 A0
-          The eight commands of this group allow the transmission of eight different analog values in 
-          digital mode.*/
-        if (notifySusiAnalogFunction) {
-          notifySusiAnalogFunction(SUSI_AN_FN_2,MyBuffer[BufferR].B.arg1);
-        }
-        break;
-      case 0x2A:
-        /*Analog function group 1 : 0010-1xxx (0x28 = 40 to 0x2F = 47) A7 A6 A5 A4 - A3 A2 A1 A0
-          The eight commands of this group allow the transmission of eight different analog values in 
-          digital mode.*/
-        if (notifySusiAnalogFunction) {
-          notifySusiAnalogFunction(SUSI_AN_FN_3,MyBuffer[BufferR].B.arg1);
-        }
-        break;
-      case 0x2B:
-        /*Analog function group 1 : 0010-1xxx (0x28 = 40 to 0x2F = 47) A7 A6 A5 A4 - A3 A2 A1 A0
-          The eight commands of this group allow the transmission of eight different analog values in 
-          digital mode.*/
-        if (notifySusiAnalogFunction) {
-          notifySusiAnalogFunction(SUSI_AN_FN_4,MyBuffer[BufferR].B.arg1);
-        }
-        break;
-      case 0x2C:
-        /*Analog function group 1 : 0010-1xxx (0x28 = 40 to 0x2F = 47) A7 A6 A5 A4 - A3 A2 A1 A0
-          The eight commands of this group allow the transmission of eight different analog values in 
-          digital mode.*/
-        if (notifySusiAnalogFunction) {
-          notifySusiAnalogFunction(SUSI_AN_FN_5,MyBuffer[BufferR].B.arg1);
-        }
-        break;
-      case 0x2D:
-        /*Analog function group 1 : 0010-1xxx (0x28 = 40 to 0x2F = 47) A7 A6 A5 A4 - A3 A2 A1 A0
-          The eight commands of this group allow the transmission of eight different analog values in 
-          digital mode.*/
-        if (notifySusiAnalogFunction) {
-          notifySusiAnalogFunction(SUSI_AN_FN_6,MyBuffer[BufferR].B.arg1);
-        }
-        break;
-      case 0x2E:
-        /*Analog function group 1 : 0010-1xxx (0x28 = 40 to 0x2F = 47) A7 A6 A5 A4 - A3 A2 A1 A0
-          The eight commands of this group allow the transmission of eight different analog values in 
-          digital mode.*/
-        if (notifySusiAnalogFunction) {
-          notifySusiAnalogFunction(SUSI_AN_FN_7,MyBuffer[BufferR].B.arg1);
-        }
-        break;
-      case 0x2F:
-        /*Analog function group 1 : 0010-1xxx (0x28 = 40 to 0x2F = 47) A7 A6 A5 A4 - A3 A2 A1 A0
-          The eight commands of this group allow the transmission of eight different analog values in 
-          digital mode.*/
-        if (notifySusiAnalogFunction) {
-          notifySusiAnalogFunction(SUSI_AN_FN_8,MyBuffer[BufferR].B.arg1);
-        }
-        break;
-      case 0x30:
-        /*Direct command 1 for analog operation : 0011-0000 (0x30 = 48) D7 D6 D5 D4 - D3 D2 D1 D0 
-           Setting of basic functions in analog mode bypassing a function assignment. 
-            Bit 0: Sound on/off 
-            Bit 1: Up/break 
-            Bit 2-6: Reserved 
-            Bit 7: Reduced volume*/
-        if (notifySusiAnalogDirectCommand) {
-          notifySusiAnalogDirectCommand(1,MyBuffer[BufferR].B.arg1);
-        }
-        break;
-      case 0x31:
-        /*Direct command 2 for analog operation : 0011-0000 (0x31 = 49) D7 D6 D5 D4 - D3 D2 D1 D0
-           Setting of basic functions in analog mode bypassing a function assignment. 
-            Bit 0: Front light 
-            Bit 1: Rear light 
-            Bit 2: Parking light 
-            Bit 3-7: Reserved*/
-        if (notifySusiAnalogDirectCommand) {
-          notifySusiAnalogDirectCommand(2,MyBuffer[BufferR].B.arg1);
-        }
-        break;
-      case 0x00:
-        /*No Operation : 0000-0000 (0x00 = 0) X X X X - X X X X
-           The command does not cause any action in the SUSI-Module. The data can have any value. 
-           The command can be used as a gap filler or for test purposes. */
-        if (notifySusiNoOperation) {
-          notifySusiNoOperation(MyBuffer[BufferR].B.arg1);
-        }
-        break;
-      case 0x5E:  // && 0x5F
-        /*Module address low : 0101-1110 (0x5E = 94) A7 A6 A5 A4 - A3 A2 A1 A0
-            Transmits the least significant bits of the active digital address of the "Host" when it is in a 
-            digital operating mode. The command is always sent in pairs before the address high byte. If the two 
-            commands do not follow each other directly, they are to be ignored. */
-        LowBinary = MyBuffer[BufferR].B.arg1;   // copy low byte for future
-        WaitHighBinary = 2;                     // set waiting flag
-        break;
-      case 0x5F:  // && 0x5E
-        if (WaitHighBinary == 2) {                   // only if previous one was 0x6E
-          WaitHighBinary = 0;                   // remove waiting flag
-          uint16_t BAddress = MyBuffer[BufferR].B.arg1;
-          BAddress = BAddress << 8;
-          BAddress |= LowBinary;
-          if (notifySusiMasterAddress) {
-            notifySusiMasterAddress(BAddress);
-          }
-        }
-        break;
-      case 0x6C:
-        /*Module control byte : 0110-1100 (0x6C = 108) B7 B6 B5 B4 - B3 B2 B1 B0 
-            Bit 0 = Buffer Control: 0 = Buffer off, 1 = Buffer on 
-            Bit 1 = Reset function: 0 = set all functions to "Off", 1 = normal operation 
-            All other bits reserved by the RailCommunity. 
-            If implemented, bits 0 and 1 must be set to 1 in the SUSI-Module after a reset. */
-        if (notifySusiControllModule) {
-          notifySusiControllModule(MyBuffer[BufferR].B.arg1);
-        }
-        break;
-      case 0x77:
-        /*CV manipulation - check byte (3-byte): 0111-0111 (0x77 = 119)   1 V6 V5 V4 - V3 V2 V1 V0 D7 D6 D5 D4 - D3 D2 D1 D0 
-            DCC command for byte check in service and operation mode
-            V = CV number 897 ... 1024 (value 0 = CV 897, value 127 = CV 1024)
-            D = comparison value for checking. If D corresponds to the stored CV value, the SUSI-Module 
-            responds with an acknowledge.
-            This and the following two commands are the 3-byte packets mentioned in section 4 according 
-            to [S-9.2.1].*/
-
-        // Special cases: CV898 (1) or CV1021 (124) = index; CV1020 (123) = Status byte
-        if (((MyBuffer[BufferR].B.arg1 & 0x7F) == 1) || ((MyBuffer[BufferR].B.arg1 & 0x7F) == 124)) {
-          if (MyBuffer[BufferR].B.arg2 == CV_Index) { SendACK(); }                         // for index response is instant ...
-        } else if ((MyBuffer[BufferR].B.arg1 & 0x7F) == 123) {      // Status Byte -> Bit 0 = Wait, Bit 1 = Slow ... 
-          if (notifySusiStatusByte) {
-            if (notifySusiStatusByte() == MyBuffer[BufferR].B.arg2) { SendACK(); }
-          }
-        } else {
-        // standard CV case
-          if (IsValidCV(MyBuffer[BufferR].B.arg1)) {                      // is command valid for this module?
-            if (notifySusiCVRead) {                                                                     // If there is a CV storage system
-              if (notifySusiCVRead(MyBuffer[BufferR].B.arg1 & 0x7F, CV_Index) == MyBuffer[BufferR].B.arg2) { SendACK(); }  // for others, function with CV and index must be called
-            }
-          }
-        }
-        break;
-      case 0x7B:
-        /*CV manipulation - bit manipulation (3-byte): 0111-1011 (0x7B = 123) 1 V6 V5 V4 - V3 V2 V1 V0 1 1 1 K - D B2 B1 B0
-            DCC command bit manipulate in service and operation mode V = CV number 897 ... 1024 
-            (value 0 = CV 897, value 127 = CV 1024)
-            K = 0: Check bit. If D matches the bit state at bit position B of the CV, the SUSI-Module responds 
-            with an acknowledge.
-            K = 1: Bit Write. D is written to bit position B of the CV. The SUSI-Module confirms the writing 
-            with an acknowledge*/
-
-        if ((MyBuffer[BufferR].B.arg2 & 0xE0) != 0xE0) {break;}     // invalid command
-        uint8_t BitMask = 1 << (MyBuffer[BufferR].B.arg2 & 0x07);         // prepare bit mask
+#if SUSI_FEATURES & SUSI_FEATURE_CV
+void SUSI2::DecodeCV(uint8_t Handler, PacketT Packet) {
+  const uint8_t Arg = Packet.B.arg1;
+  switch (Handler) {
+    case H_CV_CHECK:
+      /*CV manipulation - check byte (3-byte): 0111-0111 (0x77 = 119)   1 V6 V5 V4 - V3 V2 V1 V0 D7 D6 D5 D4 - D3 D2 D1 D0 
+          DCC command for byte check in service and operation mode
+          V = CV number 897 ... 1024 (value 0 = CV 897, value 127 = CV 1024)
+          D = comparison value for checking. If D corresponds to the stored CV value, the SUSI-Module 
+          responds with an acknowledge.
+          This and the following two commands are the 3-byte packets mentioned in section 4 according 
+          to [S-9.2.1].*/
+
+      // Special cases: CV898 (1) or CV1021 (124) = index; CV1020 (123) = Status byte
+      if (((Arg & 0x7F) == 1) || ((Arg & 0x7F) == 124)) {
+        if (Packet.B.arg2 == CV_Index) { SendACK(); }                         // for index response is instant ...
+      } else if ((Arg & 0x7F) == 123) {      // Status Byte -> Bit 0 = Wait, Bit 1 = Slow ... 
+        if (notifySusiStatusByte) {
+          if (notifySusiStatusByte() == Packet.B.arg2) { SendACK(); }
+        }
+      } else {
+      // standard CV case
         uint8_t CVValue;
-
-        // Special cases: CV898 (1) or CV1021 (124) = index; CV1020 (123) = Status byte
-        if (((MyBuffer[BufferR].B.arg1 & 0x7F) == 1) || ((MyBuffer[BufferR].B.arg1 & 0x7F) == 124)) {
-          if (MyBuffer[BufferR].B.arg2 & 0x10) {                  // K=1 for write
-            if (MyBuffer[BufferR].B.arg2 & 0x08) {CV_Index |= BitMask;} else {CV_Index &= (!BitMask);}  // for index response is instant ...
-              SendACK();                          // confirm
-          } else {                                                  // K=0 for compare
-            if (((CV_Index & BitMask) == 0) == ((MyBuffer[BufferR].B.arg2 & 0x08) == 0)) {SendACK();}                          // if they are same, confirm
-          }
-        } else if ((MyBuffer[BufferR].B.arg1 & 0x7F) == 123) {      // Status Byte -> Bit 0 = Wait, Bit 1 = Slow ... 
-          if ((!(MyBuffer[BufferR].B.arg2 & 0x10)) && (notifySusiStatusByte)) { // this is read only = compare only
-            CVValue = notifySusiStatusByte();
-            CVValue &= BitMask;
-            if ((CVValue == 0) == ((MyBuffer[BufferR].B.arg2 & 0x08) == 0)) {SendACK();}                          // if they are same, confirm
-          }
-        } else {
-        // standard CV case
-        if (IsValidCV(MyBuffer[BufferR].B.arg1)) {     // is command valid for this module?
-            if (notifySusiCVRead) {                                                                     // If there is a CV storage system
-              CVValue = notifySusiCVRead(MyBuffer[BufferR].B.arg1 & 0x7F, CV_Index);  // for others, function with CV and index must be called
-              if (MyBuffer[BufferR].B.arg2 & 0x10) {                  // K=1 for write
-                if (MyBuffer[BufferR].B.arg2 & 0x08) {CVValue |= BitMask;} else {CVValue &= (!BitMask);}
-                if (notifySusiCVWrite) {
-                  if (notifySusiCVWrite(MyBuffer[BufferR].B.arg1 & 0x7F, CV_Index, CVValue) == CVValue) {   // for others, function with CV and index must be called
-                    SendACK();     // confirm
-                  }
-                }
-              } else {                                                // K=0 for compare
-                CVValue &= BitMask;
-                if ((CVValue == 0) == ((MyBuffer[BufferR].B.arg2 & 0x08) == 0)) {SendACK();}                          // if they are same, confirm
+        if (ReadCV(Arg, CVValue) && (CVValue == Packet.B.arg2)) { SendACK(); }  // CV of served module and CV storage system present
+      }
+      break;
+    case H_CV_BIT: {
+      /*CV manipulation - bit manipulation (3-byte): 0111-1011 (0x7B = 123) 1 V6 V5 V4 - V3 V2 V1 V0 1 1 1 K - D B2 B1 B0
+          DCC command bit manipulate in service and operation mode V = CV number 897 ... 1024 
+          (value 0 = CV 897, value 127 = CV 1024)
+          K = 0: Check bit. If D matches the bit state at bit position B of the CV, the SUSI-Module responds 
+          with an acknowledge.
+          K = 1: Bit Write. D is written to bit position B of the CV. The SUSI-Module confirms the writing 
+          with an acknowledge*/
+
+      if ((Packet.B.arg2 & 0xE0) != 0xE0) {break;}     // invalid command
+      uint8_t BitMask = 1 << (Packet.B.arg2 & 0x07);         // prepare bit mask
+      uint8_t CVValue;
+
+      // Special cases: CV898 (1) or CV1021 (124) = index; CV1020 (123) = Status byte
+      if (((Arg & 0x7F) == 1) || ((Arg & 0x7F) == 124)) {
+        if (Packet.B.arg2 & 0x10) {                  // K=1 for write
+          if (Packet.B.arg2 & 0x08) {CV_Index |= BitMask;} else {CV_Index &= (uint8_t)(~BitMask);}  // for index response is instant ...
+            SendACK();                          // confirm
+        } else {                                                  // K=0 for compare
+          if (((CV_Index & BitMask) == 0) == ((Packet.B.arg2 & 0x08) == 0)) {SendACK();}                          // if they are same, confirm
+        }
+      } else if ((Arg & 0x7F) == 123) {      // Status Byte -> Bit 0 = Wait, Bit 1 = Slow ... 
+        if ((!(Packet.B.arg2 & 0x10)) && (notifySusiStatusByte)) { // this is read only = compare only
+          CVValue = notifySusiStatusByte();
+          CVValue &= BitMask;
+          if ((CVValue == 0) == ((Packet.B.arg2 & 0x08) == 0)) {SendACK();}                          // if they are same, confirm
+        }
+      } else {
+      // standard CV case
+        if (ReadCV(Arg, CVValue)) {     // CV of served module and CV storage system present
+            if (Packet.B.arg2 & 0x10) {                  // K=1 for write
+              if (Packet.B.arg2 & 0x08) {CVValue |= BitMask;} else {CVValue &= (uint8_t)(~BitMask);}
+              uint8_t Written;
+              if (WriteCV(Arg, CVValue, Written) && (Written == CVValue)) {
+                  SendACK();     // confirm
               }
+            } else {                                                // K=0 for compare
+              CVValue &= BitMask;
+              if ((CVValue == 0) == ((Packet.B.arg2 & 0x08) == 0)) {SendACK();}                          // if they are same, confirm
             }
-          }
-        }
-        break;
-      case 0x7C:
-        /*CV manipulation - write byte (3-byte): decoder reset by write CV8=8 -> 0x7C, 0x07, 0x08
-            some decoders use different value than 8 :)*/
-        if ((notifyCVResetFactoryDefault) && (MyBuffer[BufferR].B.arg1 == 0x07)) {
-          notifyCVResetFactoryDefault(MyBuffer[BufferR].B.arg2);
-          SendACK();     // confirm
-        }
-        break;
-      case 0x7F:
-        /*CV manipulation - write byte (3-byte): 0111-1111 (0x7F = 127)    1 V6 V5 V4 - V3 V2 V1 V0 D7 D6 D5 D4 - D3 D2 D1 D0
-            DCC command byte write in service and operation mode
-            V = CV number 897 ... 1024 (value 0 = CV 897, value 127 = CV 1024)
-            D = value to write into the CV. The SUSI-Module confirms the writing with an acknowledge.
-            The commands 0x01 to 0x0F, 0x80 to 0x8F and 0xE0 to 0xFF are defined in [RCN-601] and 
-            reserved for BiDi.*/
-
-        // Special cases: CV898 (1) or CV1021 (124) = index; (CV1020 (123) = Status byte is read only)
-        if (((MyBuffer[BufferR].B.arg1 & 0x7F) == 1) || ((MyBuffer[BufferR].B.arg1 & 0x7F) == 124)) {
-          CV_Index= MyBuffer[BufferR].B.arg2;
-          SendACK();                           // for index response is instant ...
-        } else {
-        // standard CV case
-          if (IsValidCV(MyBuffer[BufferR].B.arg1)) {                      // is command valid for this module?
-            if (notifySusiCVWrite)  {                                                                     // If there is a CV storage system
-              if (notifySusiCVWrite(MyBuffer[BufferR].B.arg1 & 0x7F, CV_Index,MyBuffer[BufferR].B.arg2) == MyBuffer[BufferR].B.arg2) { SendACK(); }  // for others, function with CV and index must be called
-            }
-          }
-        }
-        break;
-      default:
-        ResponseStatus = -1;
-        if (notifySusiUnknownMessage) {                                                                     // If there is a notify about unknowns
-          notifySusiUnknownMessage(MyBuffer[BufferR].B.cmnd, MyBuffer[BufferR].B.arg1);                     // notify about unknowns...
         }
-        
-        break;
+      }
+      break;
     }
-    MyBuffer[BufferR].B.used = 0;
-    if (++BufferR == BUFFER_SIZE) {BufferR = 0;}             // rotate cyrcular pointer
+    case H_CV_RESET:
+      /*CV manipulation - write byte (3-byte): decoder reset by write CV8=8 -> 0x7C, 0x07, 0x08
+          some decoders use different value than 8 :)*/
+      if ((notifyCVResetFactoryDefault) && (Arg == 0x07)) {
+#ifdef SUSI_CV_CACHE_SIZE
+        invalidateCVs();                     // application writes defaults to CV storage
+#endif
+        notifyCVResetFactoryDefault(Packet.B.arg2);
+        SendACK();     // confirm
+      }
+      break;
+    case H_CV_WRITE:
+      /*CV manipulation - write byte (3-byte): 0111-1111 (0x7F = 127)    1 V6 V5 V4 - V3 V2 V1 V0 D7 D6 D5 D4 - D3 D2 D1 D0
+          DCC command byte write in service and operation mode
+          V = CV number 897 ... 1024 (value 0 = CV 897, value 127 = CV 1024)
+          D = value to write into the CV. The SUSI-Module confirms the writing with an acknowledge.
+          The commands 0x01 to 0x0F, 0x80 to 0x8F and 0xE0 to 0xFF are defined in [RCN-601] and 
+          reserved for BiDi.*/
+
+      // Special cases: CV898 (1) or CV1021 (124) = index; (CV1020 (123) = Status byte is read only)
+      if (((Arg & 0x7F) == 1) || ((Arg & 0x7F) == 124)) {
+        CV_Index= Packet.B.arg2;
+        SendACK();                           // for index response is instant ...
+      } else {
+      // standard CV case
+        uint8_t Written;
+        if (WriteCV(Arg, Packet.B.arg2, Written) && (Written == Packet.B.arg2)) { SendACK(); }  // CV of served module and CV storage system present
+      }
+      break;
+    default:
+      break;
   }
-  return ResponseStatus;
 }
+#endif
 
 /*CV mapping:
 CV-Name                     |  CV#  |  CV#  |  CV#  | Comment
@@ -860,7 +597,7 @@ reserved                    |         1024           |
 /**********************************************************************************************************************/
 /* CV validation */
 
-bool SUSI2::IsValidCV(uint8_t CV_Value) {
+uint8_t SUSI2::ModuleOfCV(uint8_t CV_Value) {
   CV_Value ^= 0x80;                       // for standard usage upper bit must be 1, but is not practical to use.
   /*  Special cases are solved before, it make no sense to solve them here.
   if (CV_Value & 0x80) {return false;}    // only values up to 127 are allowed for new implementations
@@ -868,11 +605,138 @@ bool SUSI2::IsValidCV(uint8_t CV_Value) {
   if ((CV_Value == 123) || (CV_Value == 124)) {return true;}      // this is tricky, CV1020 and CV1021 have special handling, rest are reserved
   */
 
-  if (CV_Value == 0) {return true;}        // CV897 - module #
-  if ((_slaveAddress == 1) && (CV_Value>2) && (CV_Value<43)) {return true;} // CV900 - CV939 are correct for slave 1
-  if ((_slaveAddress == 2) && (CV_Value>42) && (CV_Value<83)) {return true;} // CV940 - CV979 are correct for slave 2
-  if ((_slaveAddress == 3) && (CV_Value>82) && (CV_Value<123)) {return true;} // CV980 - CV1019 are correct for slave 3
-  return false;
+  uint8_t Module = 0;
+  if (CV_Value == 0) {return _slaveAddress;}             // CV897 - module # belongs to primary module
+  if ((CV_Value>2) && (CV_Value<43)) {Module = 1;}       // CV900 - CV939 are correct for slave 1
+  if ((CV_Value>42) && (CV_Value<83)) {Module = 2;}      // CV940 - CV979 are correct for slave 2
+  if ((CV_Value>82) && (CV_Value<123)) {Module = 3;}     // CV980 - CV1019 are correct for slave 3
+  if (ModuleMask & SUSI_MODULE_BIT(Module)) {return Module;}
+  return 0;                                              // not served by this decoder
+}
+
+bool SUSI2::IsValidCV(uint8_t CV_Value) {
+  return ModuleOfCV(CV_Value) != 0;
+}
+
+uint8_t SUSI2::StorageRead(uint8_t Module, uint8_t CV, uint8_t Index) {
+  if (notifySusiModuleCVRead) {return notifySusiModuleCVRead(Module, CV, Index);}   // routing per module
+  return notifySusiCVRead(CV, Index);
+}
+
+uint8_t SUSI2::StorageWrite(uint8_t Module, uint8_t CV, uint8_t Index, uint8_t Value) {
+  if (notifySusiModuleCVWrite) {return notifySusiModuleCVWrite(Module, CV, Index, Value);}   // routing per module
+  return notifySusiCVWrite(CV, Index, Value);
+}
+
+bool SUSI2::ReadCV(uint8_t CV_Value, uint8_t& Value) {
+  uint8_t Module = ModuleOfCV(CV_Value);
+  if (!Module) {return false;}                           // is command valid for this module?
+  if ((!notifySusiModuleCVRead) && (!notifySusiCVRead)) {return false;}   // there is no CV storage system
+  CV_Value &= 0x7F;
+#ifdef SUSI_CV_CACHE_SIZE
+  const uint8_t Index = CacheIndex(CV_Value);
+  SusiCVEntry& Entry = CacheEntry(CV_Value, Index);
+  if ((Entry.State != SUSI_CV_EMPTY) && (Entry.CV == CV_Value) && (Entry.Index == Index)) {
+    Value = Entry.Value;                                 // hit
+    return true;
+  }
+  CacheWriteBack(Entry);                                 // entry is reused for other CV
+  Value = StorageRead(Module, CV_Value, Index);
+  Entry.CV = CV_Value;
+  Entry.Index = Index;
+  Entry.Value = Value;
+  Entry.State = SUSI_CV_CLEAN;
+#else
+  Value = StorageRead(Module, CV_Value, CV_Index);
+#endif
+  return true;
+}
+
+bool SUSI2::WriteCV(uint8_t CV_Value, uint8_t Value, uint8_t& Written) {
+  uint8_t Module = ModuleOfCV(CV_Value);
+  if (!Module) {return false;}                           // is command valid for this module?
+  if ((!notifySusiModuleCVWrite) && (!notifySusiCVWrite)) {return false;}   // there is no CV storage system
+  CV_Value &= 0x7F;
+#ifdef SUSI_CV_CACHE_SIZE
+  const uint8_t Index = CacheIndex(CV_Value);
+  SusiCVEntry& Entry = CacheEntry(CV_Value, Index);
+  if ((Entry.CV != CV_Value) || (Entry.Index != Index)) {
+    CacheWriteBack(Entry);                               // entry is reused for other CV
+  }
+  Entry.CV = CV_Value;
+  Entry.Index = Index;
+  Entry.Value = Value;
+  Entry.State = SUSI_CV_DIRTY;                           // written later by flushCVs()
+  CacheDirty = true;
+  LastCVWrite = millis();
+  Written = Value;
+#else
+  Written = StorageWrite(Module, CV_Value, CV_Index, Value);
+#endif
+  return true;
+}
+
+#ifdef SUSI_CV_CACHE_SIZE
+/**********************************************************************************************************************/
+/* CV cache */
+
+static_assert((SUSI_CV_CACHE_SIZE >= 2) && (SUSI_CV_CACHE_SIZE <= 128) && ((SUSI_CV_CACHE_SIZE & (SUSI_CV_CACHE_SIZE - 1)) == 0), "SUSI_CV_CACHE_SIZE must be power of two (2 .. 128)");
+
+uint8_t SUSI2::CacheIndex(uint8_t CV) {
+  switch (CV) {
+    case 3: case 4: case 43: case 44: case 83: case 84:  // CV900, 901, 940, 941, 980, 981 are indexed
+      return CV_Index;
+    default:                                             // other CVs are the same in every bank, one entry for all
+      return 0;
+  }
+}
+
+SusiCVEntry& SUSI2::CacheEntry(uint8_t CV, uint8_t Index) {
+  return CVCache[(uint8_t)(CV + (Index << 3)) & (SUSI_CV_CACHE_SIZE - 1)];   // consecutive CVs of one bank are in consecutive entries
+}
+
+void SUSI2::CacheWriteBack(SusiCVEntry& Entry) {
+  if (Entry.State != SUSI_CV_DIRTY) {return;}
+  uint8_t Module = ModuleOfCV(Entry.CV | 0x80);
+  if (Module) {                                          // module can be removed in the meantime
+    Entry.Value = StorageWrite(Module, Entry.CV, Entry.Index, Entry.Value);
+    CommitPending = true;
+  }
+  Entry.State = SUSI_CV_CLEAN;
+}
+
+void SUSI2::CacheIdle(void) {
+  if ((CacheDirty || CommitPending) && ((uint32_t)(millis() - LastCVWrite) >= SUSI_CV_FLUSH_DELAY)) {
+    flushCVs();
+  }
+}
+
+void SUSI2::flushCVs(void) {
+  for (uint8_t i = 0; i < SUSI_CV_CACHE_SIZE; i++) {CacheWriteBack(CVCache[i]);}
+  CacheDirty = false;
+  if (CommitPending) {
+    CommitPending = false;
+    if (notifySusiCVCommit) {notifySusiCVCommit();}      // one commit per batch
+  }
+}
+
+void SUSI2::invalidateCVs(void) {
+  flushCVs();                                            // do not lose acknowledged writes
+  for (uint8_t i = 0; i < SUSI_CV_CACHE_SIZE; i++) {CVCache[i].State = SUSI_CV_EMPTY;}
+}
+#endif
+
+/**********************************************************************************************************************/
+/* Served modules */
+
+void SUSI2::addModule(uint8_t SlaveAddress) {
+  if ((SlaveAddress > MAX_ADDRESS_VALUE) || (SlaveAddress < 1)) {return;}   // not valid address
+  ModuleMask |= SUSI_MODULE_BIT(SlaveAddress);
+}
+
+void SUSI2::removeModule(uint8_t SlaveAddress) {
+  if (SlaveAddress == _slaveAddress) {return;}                              // primary module (CV897) stays
+  ModuleMask &= (uint8_t)(~SUSI_MODULE_BIT(SlaveAddress));
 }
 
 
@@ -30,11 +30,139 @@
 /* Slave Module Addresses */
 #define DEFAULT_SLAVE_NUMBER        1                                                                                       // identifies the SUSI Slave address: default 1
 #define MAX_ADDRESS_VALUE           3                                                                                       // Maximum number of SUSI modules that can be connected to the decoder: 3
+#define SUSI_MODULE_BIT(Address)    ((uint8_t)(1 << (Address)))                                                             // bit of module in getModules() mask (bit 1 = module 1 .. bit 3 = module 3)
 
 
 /* Acquisition Buffer */
-// amount of packets in queue
-#define BUFFER_SIZE 5
+// amount of packets in queue - must be power of two (2, 4, 8 .. 128). Can be changed by build flag, for example -DSUSI_QUEUE_SIZE=32
+#ifndef SUSI_QUEUE_SIZE
+#define SUSI_QUEUE_SIZE 8
+#endif
+// By default all packets share one queue in order of reception. With SUSI_PRIORITY_SIZE defined (uncomment here, or add for example
+// -DSUSI_PRIORITY_SIZE=8 to build flags) CV manipulation (0x70 - 0x7F) and trigger pulse (0x21) packets go to priority lane, process() decodes it
+// before normal queue, then CV acknowledge and chuff are not delayed by function groups waiting in queue. Power of two (2 .. 128), 0 = no lane.
+//#define SUSI_PRIORITY_SIZE 8
+#ifndef SUSI_PRIORITY_SIZE
+#define SUSI_PRIORITY_SIZE 0
+#endif
+#if (SUSI_PRIORITY_SIZE == 0) && !defined(SUSI_NO_PRIORITY)
+#define SUSI_NO_PRIORITY        // internal - no priority lane
+#endif
+
+/* SPI peripheral */
+// SPI used for SUSI reception, interrupt handlers are bound to object by SusiPort<SUSI_SPI>. CH32V003 has SPI1 only,
+// its backend is wired to SPI1 (interrupt handler, DMA channel, pins) and refuses other value at compile time.
+#ifndef SUSI_SPI
+#define SUSI_SPI 1
+#endif
+
+/* Reception mode */
+// By default every received byte generates SPI1 interrupt. With SUSI_USE_DMA defined (uncomment here, or add -DSUSI_USE_DMA to build flags)
+// SPI1 RX feeds circular DMA buffer and packets are framed on DMA half/full transfer events, on Timer1 gap reset and by process().
+//#define SUSI_USE_DMA
+#ifndef SUSI_DMA_BUFFER_SIZE
+#define SUSI_DMA_BUFFER_SIZE 32     // size of circular DMA buffer in bytes - framing runs every SUSI_DMA_BUFFER_SIZE/2 bytes (or on 7 ms gap)
+#endif
+
+/* CV cache */
+// With SUSI_CV_CACHE_SIZE defined (uncomment here, or add for example -DSUSI_CV_CACHE_SIZE=32 to build flags) CVs are cached in RAM:
+// verify / bit check are answered from cache, writes are acknowledged immediately and written to CV storage (notifySusiCVWrite)
+// later in batch, when no CV was written for SUSI_CV_FLUSH_DELAY. notifySusiCVCommit() is called after each batch.
+// Cache is direct mapped by (CV, index), size must be power of two (2 .. 128 entries, 4 bytes each).
+//#define SUSI_CV_CACHE_SIZE 32
+#ifndef SUSI_CV_FLUSH_DELAY
+#define SUSI_CV_FLUSH_DELAY 100     // milliseconds without CV write, then cached writes are flushed
+#endif
+
+/* Synchronization gap */
+// Receiver is reset, when SUSI clock is quiet longer than gap (RCN-600: 7 ms). Timer1 values are calculated from SystemCoreClock,
+// then any core clock works. Gap can be changed in runtime by setGap(), default can be changed by build flag -DSUSI_GAP_TIME=...
+#ifndef SUSI_GAP_TIME
+#define SUSI_GAP_TIME 7000      // default gap in microseconds
+#endif
+#define SUSI_GAP_MIN  1000      // minimum accepted gap in microseconds (bytes of one packet must not be split by gap)
+
+/* Runtime statistics */
+// Counters of received bytes / packets, drops, resyncs and overruns, see getStats(). Each counter is one increment.
+// With SUSI_NO_STATS defined (uncomment here, or add -DSUSI_NO_STATS to build flags) all counters and getStats() are removed.
+//#define SUSI_NO_STATS
+
+/* Statistics - index of packet class in SusiStats.Packets */
+#define SUSI_STAT_FUNCTION          0                                                                                       // 0x60 - 0x68 function groups, 0x40 - 0x43 AUX
+#define SUSI_STAT_BINARY            1                                                                                       // 0x6D - 0x6F binary states
+#define SUSI_STAT_MOTION            2                                                                                       // 0x21 - 0x26, 0x50 - 0x52 trigger, current, speed, load
+#define SUSI_STAT_ANALOG            3                                                                                       // 0x28 - 0x31 analog functions
+#define SUSI_STAT_CONTROL           4                                                                                       // 0x00, 0x5E, 0x5F, 0x6C no operation, master address, module control
+#define SUSI_STAT_CV                5                                                                                       // 0x77, 0x7B, 0x7C, 0x7F CV manipulation
+#define SUSI_STAT_CLASSES           6
+#ifndef SUSI_NO_STATS
+#define SUSI_COUNT(Counter)         (Counters.Counter++)                                                                    // used inside SUSI2 members only
+#else
+#define SUSI_COUNT(Counter)
+#endif
+
+/* Feature selection */
+// Command families decoded by library, the same classes as in statistics. Handlers of families not selected are removed at compile time
+// and their commands are dropped in interrupt (never queued). Select by build flag, for example
+// -D'SUSI_FEATURES=(SUSI_FEATURE_FUNCTIONS|SUSI_FEATURE_MOTION|SUSI_FEATURE_CV)'
+#define SUSI_FEATURE_FUNCTIONS      (1 << SUSI_STAT_FUNCTION)                                                               // function groups, AUX
+#define SUSI_FEATURE_BINARY         (1 << SUSI_STAT_BINARY)                                                                 // binary states (short + long form, broadcasts)
+#define SUSI_FEATURE_MOTION         (1 << SUSI_STAT_MOTION)                                                                 // trigger, current, speeds, load
+#define SUSI_FEATURE_ANALOG         (1 << SUSI_STAT_ANALOG)                                                                 // analog functions, direct commands for analog operation
+#define SUSI_FEATURE_CONTROL        (1 << SUSI_STAT_CONTROL)                                                                // no operation, master address, module control
+#define SUSI_FEATURE_CV             (1 << SUSI_STAT_CV)                                                                     // CV manipulation (check, bit, write, reset)
+#define SUSI_FEATURE_ALL            ((1 << SUSI_STAT_CLASSES) - 1)
+#ifndef SUSI_FEATURES
+#define SUSI_FEATURES               SUSI_FEATURE_ALL
+#endif
+#if defined(SUSI_CV_CACHE_SIZE) && !(SUSI_FEATURES & SUSI_FEATURE_CV)
+#error "SUSI_CV_CACHE_SIZE needs SUSI_FEATURE_CV in SUSI_FEATURES"
+#endif
+
+/* Coalescing of state packets */
+// With SUSI_COALESCE defined (uncomment here, or add -DSUSI_COALESCE to build flags) speeds (0x24, 0x25, 0x50 - 0x52) and function groups
+// (0x60 - 0x68) are not queued: interrupt keeps only the newest argument of each command, process() decodes it after queued packets.
+// Older value not decoded yet is replaced (last writer wins), then slow main loop acts on fresh state and queue is left for pairs and CVs.
+//#define SUSI_COALESCE
+#define SUSI_COALESCE_SLOTS 14  // 0x24, 0x25, 0x50, 0x51, 0x52, 0x60 .. 0x68
+#if defined(SUSI_COALESCE) || !defined(SUSI_NO_PRIORITY)
+#define SUSI_REORDER            // internal - packets are not decoded in order of reception, open pair is guarded
+#endif
+
+/* Packet timestamps */
+// Every queued packet gets time of its last byte, taken in interrupt (see lastPacketTime()). Default source is micros(),
+// other one can be set by build flag, for example -D'SUSI_TIMESTAMP()=myTimer()' (it must be callable from interrupt).
+// With SUSI_NO_TIMESTAMPS defined (uncomment here, or add -DSUSI_NO_TIMESTAMPS to build flags) timestamps are removed.
+//#define SUSI_NO_TIMESTAMPS
+#ifndef SUSI_TIMESTAMP
+#define SUSI_TIMESTAMP() micros()
+#endif
+
+/* ACK pulse */
+#define SUSI_ACK_LENGTH 1500    // ACK pulse length in microseconds (RCN-600: 1 ms minimum, 2 ms maximum)
+
+/* BiDi transmit (RCN-601) */
+// With SUSI_USE_BIDI defined (uncomment here, or add -DSUSI_USE_BIDI to build flags) module answers BiDi commands (0x01 - 0x0F,
+// 0x80 - 0x8F, 0xE0 - 0xFF) set by setBiDi(): answer is shifted out by SPI1 during the byte following the command (data phase,
+// master keeps data line released). SPI1 runs full duplex, MISO (PC7) is open drain output and must be connected to SUSI data line.
+// Transmit buffer is loaded in SPI1 receive interrupt, then it works with interrupt reception only (not with SUSI_USE_DMA).
+//#define SUSI_USE_BIDI
+#ifndef SUSI_BIDI_SLOTS
+#define SUSI_BIDI_SLOTS 4       // amount of BiDi commands answered at once
+#endif
+#define SUSI_BIDI_IDLE  0xFF    // transmitted, when module does not answer - open drain output keeps data line released
+#if defined(SUSI_USE_BIDI) && defined(SUSI_USE_DMA)
+#error "SUSI_USE_BIDI needs interrupt reception, it can not be used with SUSI_USE_DMA"
+#endif
+
+/* Decoded state mirror - index of state in Mirror array */
+#define MIRROR_FN                   0                                                                                       // 9 function groups (SUSI_FN_0_4 .. SUSI_FN_61_68)
+#define MIRROR_AUX                  9                                                                                       // 4 AUX groups (SUSI_AUX_1_8 .. SUSI_AUX_25_32)
+#define MIRROR_REAL_SPEED           13                                                                                      // real speed + direction (0x24 / 0x50)
+#define MIRROR_REQUEST_SPEED        14                                                                                      // requested speed + direction (0x25 / 0x51)
+#define MIRROR_DCC_SPEED            15                                                                                      // DCC speed + direction (0x52)
+#define MIRROR_ANALOG               16                                                                                      // 8 analog functions (SUSI_AN_FN_1 .. SUSI_AN_FN_8)
+#define MIRROR_SIZE                 24                                                                                      // total (must be max 32 - one known bit per state)
 
 #define SPI_MISO PC7    // not used
 #define SPI_MOSI PC6    // SUSI data
@@ -44,19 +172,196 @@
 
 union PacketT                                                               // one packet - do not forget, we are running on 32 bit processor, then uint32 is basic unit!
 {
-  struct {uint8_t cmnd; uint8_t arg1; uint8_t arg2; uint8_t used; } B;      // three bytes represent packet + slot status = 32 bits
+  struct {uint8_t cmnd; uint8_t arg1; uint8_t arg2; uint8_t used; } B;      // three bytes represent packet + spare byte = 32 bits
   uint32_t W;                                                               // common name, good for example for clearing all, etc.
 };
 
+/* Command dispatch table entry - handler of command family + parameter (group, command number ...), table is in SUSI2.cpp */
+enum SusiHandler : uint8_t {
+  H_UNKNOWN = 0,        // not defined (or reserved) command
+  H_NOP,                // 0x00 no operation
+  H_TRIGGER,            // 0x21 trigger pulse
+  H_CURRENT,            // 0x23 motor current
+  H_SPEED,              // 0x24, 0x25, 0x50 - 0x52 speed + direction         Param = MIRROR_xxx_SPEED
+  H_LOAD,               // 0x26 motor load
+  H_ANALOG,             // 0x28 - 0x2F analog function                      Param = SUSI_AN_FN_x
+  H_ANALOG_DIRECT,      // 0x30, 0x31 direct command for analog operation    Param = command number
+  H_AUX,                // 0x40 - 0x43 direct command (AUX)                  Param = SUSI_AUX_x
+  H_ADDRESS_LOW,        // 0x5E module address low
+  H_ADDRESS_HIGH,       // 0x5F module address high
+  H_FUNC,               // 0x60 - 0x68 function group                        Param = SUSI_FN_x
+  H_MODULE_CONTROL,     // 0x6C module control byte
+  H_BINARY_SHORT,       // 0x6D binary states short form
+  H_BINARY_LOW,         // 0x6E binary states long form low byte
+  H_BINARY_HIGH,        // 0x6F binary states long form high byte
+  H_CV_CHECK,           // 0x77 CV manipulation - check byte
+  H_CV_BIT,             // 0x7B CV manipulation - bit manipulation
+  H_CV_RESET,           // 0x7C CV manipulation - reset (write CV8)
+  H_CV_WRITE,           // 0x7F CV manipulation - write byte
+  H_BIDI                // BiDi command answered by interrupt (SUSI_USE_BIDI), not in table
+};
+
+struct SusiCommand {
+  uint8_t Handler;      // SusiHandler
+  uint8_t Param;        // group, command number, ...
+};
+
+struct SusiEvent                                                            // decoded event returned by SUSI2::poll(), meaning of fields depends on Kind
+{
+  SUSI_EVENT_KIND Kind;                                                     // SUSI_EVENT_xxx
+  uint8_t Group;                                                            // function / AUX / analog group, direction of speed, command of unknown
+  uint8_t Value;                                                            // state, speed, argument
+  uint16_t Number;                                                          // binary state number, master address
+#ifndef SUSI_NO_TIMESTAMPS
+  uint32_t Time;                                                            // receive time of packet (the same as lastPacketTime())
+#endif
+};
+
+struct SusiSlot                                                             // one queue entry
+{
+  PacketT Packet;                                                           // received packet
+#ifndef SUSI_NO_TIMESTAMPS
+  uint32_t Time;                                                            // SUSI_TIMESTAMP() when last byte of packet was received
+#endif
+};
+
+#ifdef SUSI_CV_CACHE_SIZE
+struct SusiCVEntry                                                          // one cached CV
+{
+  uint8_t CV;                                                               // CV number relative to 897 (0 .. 127)
+  uint8_t Index;                                                            // CV index (bank)
+  uint8_t Value;                                                            // cached value
+  uint8_t State;                                                            // SUSI_CV_EMPTY, SUSI_CV_CLEAN, SUSI_CV_DIRTY
+};
+#define SUSI_CV_EMPTY               0                                                                                       // entry not used
+#define SUSI_CV_CLEAN               1                                                                                       // the same value as in CV storage
+#define SUSI_CV_DIRTY               2                                                                                       // written, not yet flushed to CV storage
+#endif
+
+#ifndef SUSI_NO_STATS
+struct SusiStats                                                            // snapshot returned by SUSI2::getStats(), all counters since init()
+{
+  uint32_t Bytes;                                                           // received bytes (SPI)
+  uint32_t Packets[SUSI_STAT_CLASSES];                                      // decoded packets per class (SUSI_STAT_xxx), commands filtered out by subscribe are not counted
+  uint32_t Unknown;                                                         // decoded packets with unknown command
+  uint32_t QueueDrops;                                                      // packets dropped, because queue was full (both lanes)
+  uint32_t GapResets;                                                       // receiver resynchronized by Timer1 (gap > 7 ms after some bytes)
+  uint32_t PartialResets;                                                   // the same, but partially received packet was thrown away
+  uint32_t Overruns;                                                        // SPI overrun - byte received before previous one was read
+  uint32_t Resyncs;                                                         // packet dropped by overrun or framing error (receiver resynchronized at next CV packet or gap, framing error at once)
+  uint32_t BiDiAnswers;                                                     // BiDi answers transmitted (SUSI_USE_BIDI)
+  uint32_t Coalesced;                                                       // state packets replaced by newer one before decoding (SUSI_COALESCE)
+  uint8_t QueueHighWater;                                                   // maximum amount of packets waiting in queue
+  uint8_t PriorityHighWater;                                                // maximum amount of packets waiting in priority lane (SUSI_PRIORITY_SIZE)
+};
+#endif
+
+/*
+*   SusiRing - lock-free single producer (interrupt) / single consumer (process) queue of SlotT entries
+*   Capacity must be power of two, then index wrap is only bit mask. Indexes are free running 8 bit counters,
+*   difference Head - Tail is amount of packets in queue.
+*   Producer writes slot first and then publish it by Head, consumer reads slot first and then release it by Tail.
+*/
+template <typename SlotT, uint8_t Capacity>
+class SusiRing {
+    static_assert((Capacity >= 2) && (Capacity <= 128) && ((Capacity & (Capacity - 1)) == 0), "SusiRing capacity must be power of two (2 .. 128)");
+
+    private:
+        SlotT Slot[Capacity];                                               // packets
+        volatile uint8_t Head;                                              // write position - modified by producer only
+        volatile uint8_t Tail;                                              // read position - modified by consumer only
+        volatile uint8_t HighWater;                                         // maximum amount of packets in queue - modified by producer only
+        volatile uint32_t Drops;                                            // amount of dropped packets (queue full) - modified by producer only
+
+    public:
+        SusiRing() : Head(0), Tail(0), HighWater(0), Drops(0) {}
+        /*
+        *   clear() Empty queue and reset counters. Producer must be stopped (or interrupts disabled).
+        */
+        void clear(void) { Head = Tail = HighWater = 0; Drops = 0; }
+        /*
+        *   push() Add packet to queue - producer side (interrupt)
+        *   Returns:
+        *       - true = stored, false = queue full, packet dropped
+        */
+        bool push(const SlotT& Data) {
+            uint8_t H = Head;
+            uint8_t Used = (uint8_t)(H - Tail);
+            if (Used >= Capacity) { Drops = Drops + 1; return false; }     // full, account drop
+            Slot[H & (Capacity - 1)] = Data;                                // store data ..
+            __atomic_thread_fence(__ATOMIC_RELEASE);                        // .. and make it visible before publish
+            Head = H + 1;                                                   // publish
+            if (++Used > HighWater) { HighWater = Used; }
+            return true;
+        }
+        /*
+        *   pop() Take oldest packet from queue - consumer side (process)
+        *   Returns:
+        *       - true = Data valid, false = queue empty
+        */
+        bool pop(SlotT& Data) {
+            uint8_t T = Tail;
+            if (T == Head) { return false; }                                // empty
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);                        // slot is read after Head
+            Data = Slot[T & (Capacity - 1)];
+            __atomic_thread_fence(__ATOMIC_RELEASE);                        // slot is read before release
+            Tail = T + 1;                                                   // release slot
+            return true;
+        }
+        bool empty(void) const { return Tail == Head; }
+        uint8_t size(void) const { return (uint8_t)(Head - Tail); }
+        static constexpr uint8_t capacity(void) { return Capacity; }
+        uint32_t drops(void) const { return Drops; }
+        uint8_t highWater(void) const { return HighWater; }
+};
+
 class SUSI2 {
     private:
         uint8_t	_slaveAddress;                                              // identifies the slave number on the SUSI bus (values from 1 to 3)
+        uint8_t ModuleMask;                                                 // served modules, SUSI_MODULE_BIT(address) - primary one + addModule()
 
-        PacketT MyBuffer[BUFFER_SIZE];                                      // received packet buffer
-        uint8_t BufferR, BufferW;                                           // Buffer read and write position (cyclic buffer)
+        SusiRing<SusiSlot, SUSI_QUEUE_SIZE> Queue;                          // received packet queue (interrupt -> process)
+#ifndef SUSI_NO_PRIORITY
+        SusiRing<SusiSlot, SUSI_PRIORITY_SIZE> Priority;                    // priority lane - CV manipulation and trigger pulse, decoded first
+#endif
+        PacketT Partial;                                                    // partially received packet - used in ISR routine
+        uint8_t ByteCount;                                                  // Counter of bytes in packet - used in ISR routine
+#ifndef SUSI_NO_STATS
+        SusiStats Counters;                                                 // runtime statistics (queue counters are kept by queue itself)
+        uint32_t BytesAtGap;                                                // Counters.Bytes at last counted gap
+#endif
+#ifndef SUSI_NO_TIMESTAMPS
+        uint32_t LastPacketTime;                                            // receive time of packet being decoded / last decoded
+#endif
         uint8_t CV_Index;                                                   // in actual version CVs 900, 901, 940, 941, 980, 981 are mandatory indexed
         uint8_t LowBinary;                                           // save variable for 16 bit functions, that coming in two packets
         uint8_t WaitHighBinary;                                      // indicate what packet is expected next
+        uint8_t Mirror[MIRROR_SIZE];                                        // last decoded state of functions, AUXs, speeds and analog functions
+        uint32_t MirrorKnown;                                               // bit per Mirror item - item was already received
+        bool ChangeOnly;                                                    // notify states only on change
+        uint16_t GapTime;                                                   // synchronization gap in microseconds
+#ifdef SUSI_CV_CACHE_SIZE
+        SusiCVEntry CVCache[SUSI_CV_CACHE_SIZE];                            // direct mapped CV cache
+        bool CacheDirty;                                                    // at minimum one entry is SUSI_CV_DIRTY
+        bool CommitPending;                                                 // something was written to CV storage, notifySusiCVCommit() not called yet
+        uint32_t LastCVWrite;                                               // millis() of last CV write
+#endif
+        uint8_t BinaryStates[16];                                           // bitmap of binary states 1 .. 127 (bit 0 unused)
+        uint32_t CommandFilter[8];                                          // bit per command 0x00 - 0xFF, only commands with bit set are queued
+#ifdef SUSI_COALESCE
+        volatile uint8_t LatestArg[SUSI_COALESCE_SLOTS];                    // newest argument of coalesced command - written in ISR routine
+        volatile uint8_t LatestPending[SUSI_COALESCE_SLOTS];                // 1 = newest argument was not decoded yet
+#ifndef SUSI_NO_TIMESTAMPS
+        volatile uint32_t LatestTime[SUSI_COALESCE_SLOTS];                  // receive time of newest argument
+#endif
+#endif
+#ifdef SUSI_REORDER
+        uint8_t LastQueued;                                                 // last command stored to queue (0x5E / 0x6E = pair is open) - used in ISR routine
+#endif
+#ifdef SUSI_USE_BIDI
+        volatile uint8_t BiDiCommand[SUSI_BIDI_SLOTS];                      // BiDi commands answered (0 = free slot) - read in ISR routine
+        volatile uint8_t BiDiData[SUSI_BIDI_SLOTS];                         // answer of each command
+#endif
 
     private:
         /*
@@ -64,9 +369,9 @@ class SUSI2 {
         *   Input:
         *       - None
         *   Returns:
-        *       - None
+        *       - true = done, false = SPI and timers are used by other SUSI2 object (only one is supported)
         */
-        void initClass(void);
+        bool initClass(void);
         /*
         *   IsValidCV(CV_Value) Check, if requested CV number is valid for selected slave
         *   Input:
@@ -75,6 +380,76 @@ class SUSI2 {
         *       - True/False
         */
         bool IsValidCV(uint8_t CV_Value);
+        /*
+        *   ModuleOfCV(CV_Value) Which served module owns requested CV
+        *   Input:
+        *       - CV_Value (as received, upper bit set)
+        *   Returns:
+        *       - module address 1 .. 3, 0 = CV is not served by this decoder
+        */
+        uint8_t ModuleOfCV(uint8_t CV_Value);
+        /*
+        *   ReadCV() Read CV of served module by notifySusiModuleCVRead() or notifySusiCVRead() callback
+        *   Input:
+        *       - CV_Value (as received, upper bit set)
+        *       - reference to read value
+        *   Returns:
+        *       - True = value is valid, False = CV is not served or there is no CV storage system
+        */
+        bool ReadCV(uint8_t CV_Value, uint8_t& Value);
+        /*
+        *   WriteCV() Write CV of served module by notifySusiModuleCVWrite() or notifySusiCVWrite() callback
+        *   Input:
+        *       - CV_Value (as received, upper bit set)
+        *       - value to write
+        *       - reference to value read back after write
+        *   Returns:
+        *       - True = written, False = CV is not served or there is no CV storage system
+        */
+        bool WriteCV(uint8_t CV_Value, uint8_t Value, uint8_t& Written);
+        /*
+        *   StorageRead() / StorageWrite() Direct access to CV storage by notifySusiModuleCVRead/Write() or notifySusiCVRead/Write() callback (no cache)
+        *   Input:
+        *       - module address, CV number relative to 897, CV index (and value for write)
+        *   Returns:
+        *       - value read (post write)
+        */
+        uint8_t StorageRead(uint8_t Module, uint8_t CV, uint8_t Index);
+        uint8_t StorageWrite(uint8_t Module, uint8_t CV, uint8_t Index, uint8_t Value);
+#ifdef SUSI_CV_CACHE_SIZE
+        /*
+        *   CacheIndex() Index under which CV is cached and stored - actual CV_Index for indexed CVs (900, 901, 940, 941, 980, 981), 0 for others
+        *   Input:
+        *       - CV number relative to 897
+        *   Returns:
+        *       - index
+        */
+        uint8_t CacheIndex(uint8_t CV);
+        /*
+        *   CacheEntry() Cache entry for CV and index (direct mapped)
+        *   Input:
+        *       - CV number relative to 897, CV index
+        *   Returns:
+        *       - entry (can hold other CV)
+        */
+        SusiCVEntry& CacheEntry(uint8_t CV, uint8_t Index);
+        /*
+        *   CacheWriteBack() Write dirty entry to CV storage (commit is left for flushCVs())
+        *   Input:
+        *       - entry
+        *   Returns:
+        *       - None
+        */
+        void CacheWriteBack(SusiCVEntry& Entry);
+        /*
+        *   CacheIdle() Flush cache, when no CV was written for SUSI_CV_FLUSH_DELAY (end of process() / poll())
+        *   Input:
+        *       - None
+        *   Returns:
+        *       - None
+        */
+        void CacheIdle(void);
+#endif
         /*
         *   initSPI() Initialize SPI hardware
         *   Input:
@@ -83,6 +458,32 @@ class SUSI2 {
         *       - none
         */
         void initSPI(void);
+        /*
+        *   StopReceiver() Disable receive interrupts (SPI1 or DMA, Timer1) on interrupt controller - initSPI() and initTimer1() enable them again
+        *   Input:
+        *       - none
+        *   Returns:
+        *       - none
+        */
+        void StopReceiver(void);
+#ifdef SUSI_USE_DMA
+        /*
+        *   initDMA() Initialize DMA channel for SPI1 reception into circular buffer
+        *   Input:
+        *       - none
+        *   Returns:
+        *       - none
+        */
+        void initDMA(void);
+        /*
+        *   DrainReceiver() Frame bytes, which are in DMA buffer and were not framed by interrupt yet (called by process())
+        *   Input:
+        *       - none
+        *   Returns:
+        *       - none
+        */
+        void DrainReceiver(void);
+#endif
         /*
         *   initTimer1() Initialize Timer1 hardware
         *   Input:
@@ -92,13 +493,127 @@ class SUSI2 {
         */
         void initTimer1(void);
         /*
-        *   SendACK() Send ACK pulse
+        *   setTimer1Gap() Set Timer1 prescaler and reload for GapTime at actual SystemCoreClock
+        *   Input:
+        *       - none
+        *   Returns:
+        *       - none
+        */
+        void setTimer1Gap(void);
+        /*
+        *   waitForPacket() Sleep (WFI), if queue is empty. Interrupts are disabled between check and WFI,
+        *   then packet queued just after check is not missed - pending interrupt wakes the core anyway.
+        *   Input:
+        *       - none
+        *   Returns:
+        *       - none
+        */
+        void waitForPacket(void);
+        /*
+        *   initTimer2() Initialize Timer2 hardware for ACK pulse length
+        *   Input:
+        *       - none
+        *   Returns:
+        *       - none
+        */
+        void initTimer2(void);
+        /*
+        *   SendACK() Start ACK pulse. Data line is pulled low and released by Timer2 interrupt after SUSI_ACK_LENGTH, function does not wait
         *   Input:
         *       - none
         *   Returns:
         *       - none
         */
         void SendACK(void);
+        /*
+        *   UpdateState() Store decoded value to state mirror
+        *   Input:
+        *       - index of state (MIRROR_xxx)
+        *       - new value
+        *   Returns:
+        *       - True = callback should be called (value changed, first value, or notification of all values is enabled)
+        */
+        bool UpdateState(uint8_t Index, uint8_t Value);
+        /*
+        *   DecodeStart() Common start of decoding - look up command in dispatch table, count packet, cancel unfinished pair
+        *   Input:
+        *       - command byte
+        *   Returns:
+        *       - handler and its parameter
+        */
+        SusiCommand DecodeStart(uint8_t Command);
+        /*
+        *   DecodeCV() Decode CV manipulation packet (CV storage is accessed by weak callbacks)
+        *   Input:
+        *       - handler (H_CV_xxx), packet
+        *   Returns:
+        *       - None
+        */
+        void DecodeCV(uint8_t Handler, PacketT Packet);
+        /*
+        *   DecodePacket() Decode one packet and invoke callbacks of Notify object (dispatch by command table, see SUSI2Dispatch.h)
+        *   Input:
+        *       - received packet
+        *       - callbacks object
+        *   Returns:
+        *       - True = known command, False = unknown command
+        */
+        template<class Callbacks> bool DecodePacket(PacketT Packet, Callbacks& Notify);
+        /*
+        *   PopPacket() Next packet to decode - from priority lane, queue, then (with SUSI_COALESCE) newest coalesced ones
+        *   While pair (0x5E/0x5F, 0x6E/0x6F) is open, its second half can come only by queue, other sources wait for it.
+        *   Input:
+        *       - slot to fill
+        *   Returns:
+        *       - true = packet returned, false = nothing to decode
+        */
+        bool PopPacket(SusiSlot& Slot) {
+#ifdef SUSI_REORDER
+            if (WaitHighBinary) {return Queue.pop(Slot);}                   // priority packet or coalesced value must not split pair
+#endif
+#ifndef SUSI_NO_PRIORITY
+            if (Priority.pop(Slot)) {return true;}
+#endif
+            if (Queue.pop(Slot)) {return true;}
+#ifdef SUSI_COALESCE
+            return PopLatest(Slot);
+#else
+            return false;
+#endif
+        }
+        /*
+        *   Waiting() Packets ready for decoding (both lanes + coalesced ones, only queue while pair is open)
+        *   Input:
+        *       - None
+        *   Returns:
+        *       - amount of packets
+        */
+#ifdef SUSI_COALESCE
+        uint16_t Waiting(void);
+        /*
+        *   PopLatest() Newest argument of one coalesced command, pending flag is cleared before argument is read,
+        *   then value written by interrupt meanwhile is decoded by next call
+        *   Input:
+        *       - slot to fill
+        *   Returns:
+        *       - true = packet returned, false = nothing pending
+        */
+        bool PopLatest(SusiSlot& Slot);
+#elif !defined(SUSI_NO_PRIORITY)
+        uint16_t Waiting(void) { return WaitHighBinary ? Queue.size() : (uint16_t)(Priority.size() + Queue.size()); }   // see PopPacket
+#else
+        uint16_t Waiting(void) { return Queue.size(); }
+#endif
+        /*
+        *   UpdateBinaryState() / UpdateBinaryStates() Store binary state (1 .. 127) / all binary states to bitmap
+        *   Input:
+        *       - binary state number (single state only)
+        *       - new state
+        *   Returns:
+        *       - None
+        */
+        void UpdateBinaryState(uint8_t Command, bool State);
+        void UpdateBinaryStates(bool State);
 
     public:
         /*
@@ -131,17 +646,17 @@ class SUSI2 {
         *   Input:
         *       - None
         *   Returns:
-        *       - None
+        *       - true = done, false = other SUSI2 object is initialized already (only one is supported), nothing was done
         */
-        void init(void);
+        bool init(void);
         /*
         *   init() Initialize the library by passing the Slave address
         *   Input:
         *       - Slave address: 1, 2, 3
         *   Returns:
-        *       - None
+        *       - true = done, false = other SUSI2 object is initialized already (only one is supported), nothing was done
         */
-        void init(uint8_t SlaveAddress);
+        bool init(uint8_t SlaveAddress);
         /*
         *   process() It should be invoked as much as possible: decoding the raw messages acquired
         *   Input:
@@ -152,16 +667,460 @@ class SUSI2 {
 *       -  1	VALID MESSAGEs decoded from queue (all available)
         */
         int8_t process(void);
+        /*
+        *   process() The same, but callbacks are members of Notify object - class derived from SusiCallbacks<> (static binding,
+        *   calls are inlined and there are no tests of weak symbols), see SUSI2Dispatch.h. Weak callbacks of sketch are not called then
+        *   (except CV manipulation ones).
+        *   Input:
+        *       - callbacks object
+        *   Returns:
+        *       - the same as process()
+        */
+        template<class Callbacks> int8_t process(Callbacks& Notify);
+        /*
+        *   process() Bounded version - stops, when budget is used, rest of queue is decoded by next call. Packet is never split
+        *   (broadcast of binary states to notifySusiBinaryState() is 127 calls in one packet, notifySusiBinaryStateBroadcast() is one).
+        *   At minimum one packet is decoded per call. Cached CVs are flushed only when queue was emptied.
+        *   Input:
+        *       - maximum packets to decode (0 = no limit)
+        *       - maximum time in microseconds (0 = no limit), checked after each packet - call can take longer by one packet
+        *   Returns:
+        *       - packets left in queue (0 = all done)
+        */
+        uint16_t process(uint8_t MaxPackets, uint16_t MaxMicros);
+        template<class Callbacks> uint16_t process(Callbacks& Notify, uint8_t MaxPackets, uint16_t MaxMicros);
+        /*
+        *   addModule() Serve one more module address by this decoder (for example combined light + sound board as module 1 and 2)
+        *   Call it after init(), init() serves the primary module only.
+        *   CVs of all served modules are routed by notifySusiModuleCVRead/Write(), or notifySusiCVRead/Write() if module version is not implemented.
+        *   Input:
+        *       - module address 1 .. 3 (other values are ignored)
+        *   Returns:
+        *       - None
+        */
+        void addModule(uint8_t SlaveAddress);
+        /*
+        *   removeModule() Stop serving module address added by addModule(). Primary module (from init) can not be removed.
+        *   Input:
+        *       - module address 1 .. 3
+        *   Returns:
+        *       - None
+        */
+        void removeModule(uint8_t SlaveAddress);
+        /*
+        *   getModules() Served modules
+        *   Input:
+        *       - None
+        *   Returns:
+        *       - mask of SUSI_MODULE_BIT(address)
+        */
+        uint8_t getModules(void) { return ModuleMask; }
+        /*
+        *   idle() Low power version of process(): if queue is empty, core sleeps (WFI) until next interrupt, then received packets are decoded.
+        *   Wake-up sources are SPI1 RX (or DMA), Timer1 gap, Timer2 ACK and all other enabled interrupts (for example SysTick of millis()).
+        *   Input:
+        *       - None
+        *   Returns:
+        *       - the same as process()
+        */
+        int8_t idle(void);
+        /*
+        *   poll() Pull version of process(): decode queued packets until one produces event, then return it instead of invoking callbacks.
+        *   Pairs (0x5E/0x5F, 0x6E/0x6F) are merged to one event, CV manipulation is done inside (weak CV callbacks, ACK) without event,
+        *   broadcast of binary states is one event. With notifyChangesOnly(true) unchanged states give no event.
+        *   Weak callbacks (except CV ones) are not invoked by poll(), do not mix it with process() for the same purpose.
+        *   Input:
+        *       - event to fill
+        *   Returns:
+        *       - true = event returned, false = queue is empty
+        */
+        bool poll(SusiEvent& Event);
+#ifdef SUSI_CV_CACHE_SIZE
+        /*
+        *   flushCVs() Write all cached CV writes to CV storage now and call notifySusiCVCommit() (it is done automatically by process(),
+        *   SUSI_CV_FLUSH_DELAY after last write). Call it for example before power off.
+        *   Input:
+        *       - None
+        *   Returns:
+        *       - None
+        */
+        void flushCVs(void);
+        /*
+        *   invalidateCVs() Flush and forget all cached CVs - call it, when application changed CV storage itself
+        *   Input:
+        *       - None
+        *   Returns:
+        *       - None
+        */
+        void invalidateCVs(void);
+#endif
         /*
         *   AddToQueue() It must public for visibility. Is used by interrupt handler to add data to object
+        *   This and following receive functions are inline, then whole enqueue path is compiled into interrupt handler (no call).
         *   Input:
         *       - Object to add to queue
         *   Returns:
         *       - None
         */
-        void AddToQueue(PacketT ReceivedData);
+        void AddToQueue(PacketT ReceivedData) {
+            uint8_t Command = ReceivedData.B.cmnd;
+            if (!(CommandFilter[Command >> 5] & ((uint32_t)1 << (Command & 0x1F)))) {return;}   // application is not interested in this command
+#ifdef SUSI_COALESCE
+            uint8_t Latest = 0xFF;                                          // slot of coalesced command
+            if ((uint8_t)(Command - 0x60) <= 8) {Latest = 5 + (Command - 0x60);}        // function groups
+            else if ((uint8_t)(Command - 0x50) <= 2) {Latest = 2 + (Command - 0x50);}   // speeds
+            else if ((uint8_t)(Command - 0x24) <= 1) {Latest = Command - 0x24;}         // old speeds
+            if ((Latest != 0xFF) && (LastQueued != 0x5E) && (LastQueued != 0x6E)) {   // inside pair it is queued, pair is ignored then
+                if (LatestPending[Latest]) {SUSI_COUNT(Coalesced);}         // older one was not decoded, it is replaced
+                LatestArg[Latest] = ReceivedData.B.arg1;
+#ifndef SUSI_NO_TIMESTAMPS
+                LatestTime[Latest] = SUSI_TIMESTAMP();
+#endif
+                LatestPending[Latest] = 1;                                  // flag last, value is ready
+                return;
+            }
+#endif
+            SusiSlot Slot;
+            Slot.Packet = ReceivedData;
+#ifndef SUSI_NO_TIMESTAMPS
+            Slot.Time = SUSI_TIMESTAMP();                                   // packet is complete now
+#endif
+#ifndef SUSI_NO_PRIORITY
+            if ((((Command & 0xF0) == 0x70) || (Command == 0x21))           // CV manipulation, trigger pulse - decoded before others,
+                && (LastQueued != 0x5E) && (LastQueued != 0x6E)) {          // inside pair it is queued, pair is ignored then
+                Priority.push(Slot);
+                return;
+            }
+#endif
+#ifdef SUSI_REORDER
+            if (Queue.push(Slot)) {LastQueued = Command;}                   // store data, if queue is full drop is counted
+#else
+            Queue.push(Slot);                                               // store data, if queue is full drop is counted
+#endif
+        }
+        /*
+        *   ReceiveByte() Packet framing - put one received byte to partial packet, complete packets goes to queue.
+        *   Called from SPI1 interrupt (byte by byte), or from DMA/Timer1 interrupt (for all bytes collected by DMA).
+        *   Input:
+        *       - received byte
+        *   Returns:
+        *       - None
+        */
+        void ReceiveByte(uint8_t Data) {
+            SUSI_COUNT(Bytes);
+            switch (ByteCount) {
+                case 0 :
+                    Partial.B.cmnd = Data;                                  // read data to command
+                    ByteCount++;
+                    break;
+                case 1 :
+                    Partial.B.arg1 = Data;                                  // read data to arg1
+                    if ( (Partial.B.cmnd & 0xF0) == 0x70 )                  // is it 3 byte command? (CV manipulation)
+                        {
+                            if ((!(Data & 0x80)) && ((Partial.B.cmnd == 0x77) || (Partial.B.cmnd == 0x7B) || (Partial.B.cmnd == 0x7F)))   // CV number must have bit 7 set
+                                {FramingError(); break;}                    // CV number was lost, this is value - skip it
+                            ByteCount++;                                    // yes, then read next byte
+                        }
+                    else
+                        {
+                            ByteCount = 0;                                  // reset for next one
+                            AddToQueue(Partial);                            // add to my queue
+                            Partial.W = 0;
+                        }
+                    break;
+                case 2 :
+                    if ((Partial.B.cmnd == 0x7B) && ((Data & 0xE0) != 0xE0))    // bit manipulation must be 111K DBBB
+                        {
+                            FramingError();                                 // argument was lost, this is command of next packet
+                            Partial.B.cmnd = Data;
+                            ByteCount = 1;
+                            break;
+                        }
+                    Partial.B.arg2 = Data;                                  // read data to arg2 (must be programming command)
+                    ByteCount = 0;
+                    AddToQueue(Partial);                                    // add to my queue
+                    Partial.W = 0;
+                    break;
+                case 3 :                                                    // bytes were lost by overrun, position in packet is unknown
+                    if (((Partial.B.cmnd == 0x77) || (Partial.B.cmnd == 0x7B) || (Partial.B.cmnd == 0x7F)) && (Data & 0x80))
+                        {
+                            Partial.B.arg1 = Data;                          // CV command followed by CV number - in sync again
+                            ByteCount = 2;
+                        }
+                    else
+                        {
+                            Partial.B.cmnd = Data;                          // discard, but it can be command of next packet
+                        }
+                    break;
+                default :                                                   // some error???
+                    ByteCount = 0;                                          // reset receiver
+                    break;
+            }
+        }
+        /*
+        *   FramingError() Byte can not be argument of partially received packet - bytes are shifted (lost or extra byte).
+        *   Packet is dropped and receiver is resynchronized at once, then only one packet is lost instead of decoding
+        *   shifted bytes until the next gap.
+        *   Input:
+        *       - None
+        *   Returns:
+        *       - None
+        */
+        void FramingError(void) {
+            SUSI_COUNT(Resyncs);
+            ResetReceiver();
+        }
+        /*
+        *   ResetReceiver() Forget partially received packet, next byte is command byte again
+        *   Input:
+        *       - None
+        *   Returns:
+        *       - None
+        */
+        void ResetReceiver(void) {
+            ByteCount = 0;                                                  // reset counter of bytes in packet
+            Partial.W = 0;                                                  // empty partially received data
+        }
+        /*
+        *   GapReceiver() Resynchronization on gap (Timer1 interrupt). Timer1 fires every gap also on idle bus,
+        *   then only gap after some received bytes is counted.
+        *   Input:
+        *       - None
+        *   Returns:
+        *       - None
+        */
+        void GapReceiver(void) {
+#ifndef SUSI_NO_STATS
+            if (Counters.Bytes != BytesAtGap) {                             // something received since last gap
+                SUSI_COUNT(GapResets);
+                BytesAtGap = Counters.Bytes;
+            }
+            if ((ByteCount) && (ByteCount != 3)) {SUSI_COUNT(PartialResets);}   // packet was not complete (not searching after overrun)
+#endif
+            ResetReceiver();
+        }
+        /*
+        *   OverrunReceiver() SPI overrun detected by interrupt handler - one or more bytes following the last received one were lost.
+        *   Packet containing lost bytes is dropped. Amount of lost bytes is not known, then following bytes are discarded until
+        *   receiver finds CV command (0x77, 0x7B, 0x7F) followed by CV number (bit 7 set) - the same check as framing of CV packets,
+        *   this packet is received already. Two byte packets can not be checked, then without CV packets on bus it is the gap
+        *   (GapReceiver), which synchronizes receiver - loss is not only one packet then, but shifted bytes are never decoded.
+        *   Input:
+        *       - None
+        *   Returns:
+        *       - None
+        */
+        void OverrunReceiver(void) {
+            SUSI_COUNT(Overruns);
+            SUSI_COUNT(Resyncs);
+            Partial.W = 0;                                                  // drop partial packet
+            ByteCount = 3;                                                  // discard until CV packet or gap
+        }
+#ifdef SUSI_USE_BIDI
+        /*
+        *   BiDiTransmit() Byte for SPI transmit buffer, it is shifted out together with next received byte.
+        *   Called from SPI1 interrupt before ReceiveByte(), then first byte of packet is the command.
+        *   Input:
+        *       - just received byte
+        *   Returns:
+        *       - answer, when byte is command set by setBiDi(), otherwise SUSI_BIDI_IDLE
+        */
+        uint8_t BiDiTransmit(uint8_t Data) {
+            if ((ByteCount != 0) || (Data == 0)) {return SUSI_BIDI_IDLE;}   // only command byte is answered (0 = free slot)
+            for (uint8_t i = 0; i < SUSI_BIDI_SLOTS; i++) {
+                if (BiDiCommand[i] == Data) {
+                    SUSI_COUNT(BiDiAnswers);
+                    return BiDiData[i];
+                }
+            }
+            return SUSI_BIDI_IDLE;
+        }
+#endif
+        /*
+        *   subscribeAll() All commands are queued for process() (default) - only commands of SUSI_FEATURES are queued by all subscribe methods
+        *   unsubscribeAll() Only pairs (0x5E/0x5F, 0x6E/0x6F) and CV manipulation (0x70 - 0x7F) are queued, rest is dropped in interrupt
+        *   subscribe() Add range of commands to queued ones
+        *   subscribeLinked() Queue only commands, for which callback is implemented (raw message callback means all commands)
+        *   Input:
+        *       - first and last command of range (subscribe only)
+        *   Returns:
+        *       - None
+        */
+        void subscribeAll(void);
+        void unsubscribeAll(void);
+        void subscribe(uint8_t FirstCommand, uint8_t LastCommand);
+        void subscribeLinked(void);
+        /*
+        *   getAckStatus() Status of the last ACK pulse
+        *   Input:
+        *       - None
+        *   Returns:
+        *       - SUSI_ACK_IDLE (no ACK since init), SUSI_ACK_BUSY (pulse is running), SUSI_ACK_DONE (pulse finished)
+        */
+        SUSI_ACK_STATUS getAckStatus(void);
+        /*
+        *   setGap() Set synchronization gap - receiver is reset, when SUSI clock is quiet longer than gap. Can be called before or after init()
+        *   Input:
+        *       - gap in microseconds (SUSI_GAP_MIN .. 65535, default SUSI_GAP_TIME = 7000). Shorter gap with fast master recovers sooner after glitch.
+        *   Returns:
+        *       - None
+        */
+        void setGap(uint16_t Microseconds);
+        /*
+        *   getGap() Actual synchronization gap
+        *   Input:
+        *       - None
+        *   Returns:
+        *       - gap in microseconds
+        */
+        uint16_t getGap(void) { return GapTime; }
+#ifdef SUSI_USE_BIDI
+        /*
+        *   setBiDi() Set answer of BiDi command - it is transmitted every time master sends the command, until it is changed or cleared.
+        *   Call it after init() (init() clears all answers). Safe to call any time, also from callbacks.
+        *   Input:
+        *       - BiDi command (0x01 - 0x0F, 0x80 - 0x8F, 0xE0 - 0xFF)
+        *       - answer byte (for example notifySusiStatusByte() value)
+        *   Returns:
+        *       - true = set, false = command is not BiDi one or all SUSI_BIDI_SLOTS are used
+        */
+        bool setBiDi(uint8_t Command, uint8_t Data);
+        /*
+        *   clearBiDi() Stop answering BiDi command
+        *   Input:
+        *       - BiDi command
+        *   Returns:
+        *       - None
+        */
+        void clearBiDi(uint8_t Command);
+#endif
+        /*
+        *   notifyChangesOnly() Select notification of function, AUX, speed and analog states
+        *   Input:
+        *       - true = callback is invoked only when state changed, false = callback is invoked for every received packet (default)
+        *   Returns:
+        *       - None
+        */
+        void notifyChangesOnly(bool Enable);
+        /*
+        *   getFunction() Last decoded state of function
+        *   Input:
+        *       - function number 0 .. 68
+        *   Returns:
+        *       - True = function is active
+        */
+        bool getFunction(uint8_t Function);
+        /*
+        *   getFunctionGroup() Last decoded state of function group (the same value as in notifySusiFunc)
+        *   Input:
+        *       - function group SUSI_FN_0_4 .. SUSI_FN_61_68
+        *   Returns:
+        *       - state of the function group
+        */
+        uint8_t getFunctionGroup(SUSI_FN_GROUP Group);
+        /*
+        *   getAux() Last decoded state of AUX
+        *   Input:
+        *       - AUX number 1 .. 32
+        *   Returns:
+        *       - True = AUX is active
+        */
+        bool getAux(uint8_t Aux);
+        /*
+        *   getAuxGroup() Last decoded state of AUX group (the same value as in notifySusiAux)
+        *   Input:
+        *       - AUX group SUSI_AUX_1_8 .. SUSI_AUX_25_32
+        *   Returns:
+        *       - state of the AUX group
+        */
+        uint8_t getAuxGroup(SUSI_AUX_GROUP Group);
+        /*
+        *   getRealSpeed() / getRealDirection() Last decoded real speed and direction
+        *   getRequestSpeed() / getRequestDirection() Last decoded requested speed and direction
+        *   getDCCSpeed() / getDCCDirection() Last decoded DCC speed and direction
+        *   Input:
+        *       - None
+        *   Returns:
+        *       - speed (128 steps) / direction
+        */
+        uint8_t getRealSpeed(void);
+        SUSI_DIRECTION getRealDirection(void);
+        uint8_t getRequestSpeed(void);
+        SUSI_DIRECTION getRequestDirection(void);
+        uint8_t getDCCSpeed(void);
+        SUSI_DIRECTION getDCCDirection(void);
+        /*
+        *   getAnalogFunction() Last decoded value of analog function
+        *   Input:
+        *       - analog function SUSI_AN_FN_1 .. SUSI_AN_FN_8
+        *   Returns:
+        *       - value of the analog function
+        */
+        uint8_t getAnalogFunction(SUSI_AN_GROUP Group);
+        /*
+        *   getBinaryState() Last decoded binary state (short form, or long form with number up to 127, including broadcasts)
+        *   Input:
+        *       - binary state number 1 .. 127
+        *   Returns:
+        *       - True = state is active
+        */
+        bool getBinaryState(uint8_t Command);
+        /*
+        *   getQueueDrops() Amount of packets dropped, because queue (or priority lane) was full
+        *   Input:
+        *       - None
+        *   Returns:
+        *       - dropped packets since init()
+        */
+#ifndef SUSI_NO_PRIORITY
+        uint32_t getQueueDrops(void) { return Queue.drops() + Priority.drops(); }
+#else
+        uint32_t getQueueDrops(void) { return Queue.drops(); }
+#endif
+        /*
+        *   getQueueHighWater() Maximum amount of packets waiting in queue
+        *   Input:
+        *       - None
+        *   Returns:
+        *       - maximum queue depth since init() (SUSI_QUEUE_SIZE means, queue was full)
+        */
+        uint8_t getQueueHighWater(void) { return Queue.highWater(); }
+#ifndef SUSI_NO_TIMESTAMPS
+        /*
+        *   lastPacketTime() Receive time of packet being decoded (inside callback), or of last decoded one (after process())
+        *   Time is taken in interrupt, when last byte of packet arrived - it is not affected by delay of process() in main loop.
+        *   In DMA mode packets are framed in batches, then time is of the batch (DMA half/full buffer, process() or 7 ms gap).
+        *   Input:
+        *       - None
+        *   Returns:
+        *       - SUSI_TIMESTAMP() value (default micros())
+        */
+        uint32_t lastPacketTime(void) { return LastPacketTime; }
+#endif
+#ifndef SUSI_NO_STATS
+        /*
+        *   getStats() Runtime statistics - helps to find, if packets are lost (drops, resyncs, overruns)
+        *   Input:
+        *       - None
+        *   Returns:
+        *       - copy of all counters since init()
+        */
+        SusiStats getStats(void);
+#endif
+
+};
 
+/*
+*   SusiPort - binding of interrupt handlers to SUSI2 object, one per SPI peripheral (template parameter = SPI number).
+*   Bus is set by init(), interrupt handler of SPIn calls SusiPort<n>::Bus->ReceiveByte() directly - receive members are inline,
+*   then enqueue path is only few loads and stores. Only one SUSI2 object is supported: hardware backend uses SPI1, TIM1, TIM2
+*   and PC6 directly (ACK and DMA state are file globals there), then init() of second object fails and destructor releases Bus.
+*/
+template <uint8_t Spi>
+struct SusiPort {
+    static SUSI2* Bus;                                                      // object receiving on this SPI
 };
+template <uint8_t Spi> SUSI2* SusiPort<Spi>::Bus = 0;
 
 
 
@@ -257,6 +1216,17 @@ extern "C" {
         */
         extern  void notifySusiBinaryStateL(uint16_t Command, uint8_t CommandState) __attribute__((weak));
         /*
+        *   notifySusiBinaryStateBroadcast() it is invoked when: broadcast for all binary states is received from the Master (short form L=0, or long form H=L=0)
+        *                                    If it is not implemented, notifySusiBinaryState() is invoked for each state 1 .. 127 (short form) and notifySusiBinaryStateL() with number 0 (long form)
+        *   Input:
+        *       - the state of all states (active = 1, inactive = 0)
+        *       - first state number of range (1)
+        *       - last state number of range (127 for short form, 32767 for long form)
+        *   Returns:
+        *       - None
+        */
+        extern  void notifySusiBinaryStateBroadcast(uint8_t CommandState, uint16_t FirstCommand, uint16_t LastCommand) __attribute__((weak));
+        /*
         *   notifySusiAux() it is invoked when: data is received from the Master on the status of a specific AUX
         *   Input:
         *       - the AUX number
@@ -391,6 +1361,27 @@ extern "C" {
         *       - the value read (post write) at the requested position
         */
         extern uint8_t notifySusiCVWrite(uint8_t CV, uint8_t CVindex, uint8_t Value) __attribute__((weak));
+        /*
+        *   notifySusiModuleCVRead() It is invoked when: reading a CV of one of served modules is requested (see addModule()). If it is not implemented, notifySusiCVRead() is used
+        *   Input:
+        *       - module address 1 .. 3 (CV897 belongs to primary module)
+        *       - the CV number to read - relative to base value 897! (0=CV897, 1=CV898, ... 127=CV1024)
+        *       - the CV index
+        *   Returns:
+        *       - returns the value of the read CV
+        */
+        extern uint8_t notifySusiModuleCVRead(uint8_t Module, uint8_t CV, uint8_t CVindex) __attribute__((weak));
+        /*
+        *   notifySusiModuleCVWrite() it is invoked when: writing a CV of one of served modules is required. If it is not implemented, notifySusiCVWrite() is used
+        *   Input:
+        *       - module address 1 .. 3 (CV897 belongs to primary module)
+        *       - the number of the requested CV
+        *       - the CV index
+        *       - the New Value of CV
+        *   Returns:
+        *       - the value read (post write) at the requested position
+        */
+        extern uint8_t notifySusiModuleCVWrite(uint8_t Module, uint8_t CV, uint8_t CVindex, uint8_t Value) __attribute__((weak));
         /* CV1020 is a status byte and is used, for example, for a WAIT function. This CV applies to all Modules and is not switched via CV 1021.
         * 
         *  notifySusiStatusByte() Called when host read CV1020 information. This CV is usually controled momentary by module status
@@ -400,6 +1391,15 @@ extern "C" {
         *       - Status byte - as requested in S-9.4.2/RCN-601 CV1020 (Bit 0 "WAIT", Bit 1 "SLOW", Bit 2 "HOLD", Bit 3 "STOP")
         */
         extern uint8_t notifySusiStatusByte(void) __attribute__((weak));
+        /*
+        *   notifySusiCVCommit() Called after batch of cached CV writes was written by notifySusiCVWrite() (only with SUSI_CV_CACHE_SIZE)
+        *   It is right place for EEPROM.commit() - one flash write per batch instead of one per CV.
+        *   Inputs:
+        *       - none
+        *   Returns:
+        *       - None
+        */
+        extern void notifySusiCVCommit(void) __attribute__((weak));
         /* RESET CVs, the same method as the NmraDcc Library is used:
         * 
         *  notifyCVResetFactoryDefault() Called when CVs must be reset. This is called when CVs must be reset to their factory defaults.
@@ -413,4 +1413,6 @@ extern "C" {
 }
 #endif
 
+#include "SUSI2Dispatch.h"                                                                                                  // process() with static callbacks
+
 #endif
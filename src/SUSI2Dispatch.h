@@ -0,0 +1,393 @@
+/*
+  Static dispatch of decoded packets for SUSI2 library (included at the end of SUSI2.h)
+
+  process() decodes packets and invokes callbacks of object given as template parameter. Callbacks are bound at compile time,
+  then they are inlined to dispatch and there is no test of weak symbol. Sketch derives own class from SusiCallbacks
+  and implements only needed callbacks - with the same names and parameters as weak notifySusi... functions:
+
+    class LightCallbacks : public SusiCallbacks<LightCallbacks> {
+      public:
+        void notifySusiFunc(SUSI_FN_GROUP SUSI_FuncGrp, uint8_t SUSI_FuncState) { ... }
+    };
+    LightCallbacks Callbacks;
+    ...
+    SUSI.process(Callbacks);
+
+  process() without parameter uses SusiWeakCallbacks - weak notifySusi... functions, as before.
+  CV manipulation (notifySusiCVRead/Write, notifySusiModuleCV..., notifySusiStatusByte, notifyCVResetFactoryDefault) is always done
+  by weak functions, they are used also outside of process() (init(), CV cache).
+
+  Created by Jindra Fucik / https://www.fucik.name
+*/
+
+#ifndef SUSI2_DISPATCH_H
+#define SUSI2_DISPATCH_H
+
+/*
+*   SusiCallbacks - base of static callbacks (CRTP). Every callback does nothing, derived class hides the ones it needs.
+*   Broadcast of binary states calls notifySusiBinaryState() for each state 1 .. 127 (short form), or notifySusiBinaryStateL(0, ...) (long form),
+*   when derived class does not implement notifySusiBinaryStateBroadcast() - the same as weak callbacks.
+*/
+template<class Derived> class SusiCallbacks {
+    public:
+        void notifySusiRawMessage(uint8_t /*firstByte*/, uint8_t /*secondByte*/) {}
+        void notifySusiRawMessage3b(uint8_t /*firstByte*/, uint8_t /*secondByte*/, uint8_t /*thirdByte*/) {}
+        void notifySusiFunc(SUSI_FN_GROUP /*SUSI_FuncGrp*/, uint8_t /*SUSI_FuncState*/) {}
+        void notifySusiBinaryState(uint8_t /*Command*/, uint8_t /*CommandState*/) {}
+        void notifySusiBinaryStateL(uint16_t /*Command*/, uint8_t /*CommandState*/) {}
+        void notifySusiBinaryStateBroadcast(uint8_t CommandState, uint16_t FirstCommand, uint16_t LastCommand) {
+            Derived& Self = static_cast<Derived&>(*this);
+            if (LastCommand < 128) {
+                for (uint16_t i = FirstCommand; i <= LastCommand; i++) {Self.notifySusiBinaryState(i, CommandState);}
+            } else {
+                Self.notifySusiBinaryStateL(0, CommandState);                   // 0 means broadcast
+            }
+        }
+        void notifySusiAux(SUSI_AUX_GROUP /*SUSI_auxGrp*/, uint8_t /*SUSI_AuxState*/) {}
+        void notifySusiTriggerPulse(uint8_t /*state*/) {}
+        void notifySusiMotorCurrent(int8_t /*current*/) {}
+        void notifySusiRequestSpeed(uint8_t /*Speed*/, SUSI_DIRECTION /*Dir*/) {}
+        void notifySusiDCCSpeed(uint8_t /*Speed*/, SUSI_DIRECTION /*Dir*/) {}
+        void notifySusiRealSpeed(uint8_t /*Speed*/, SUSI_DIRECTION /*Dir*/) {}
+        void notifySusiMotorLoad(int8_t /*load*/) {}
+        void notifySusiAnalogFunction(SUSI_AN_GROUP /*SUSI_AnalogGrp*/, uint8_t /*SUSI_AnalogState*/) {}
+        void notifySusiAnalogDirectCommand(uint8_t /*functionNumber*/, uint8_t /*Value*/) {}
+        void notifySusiNoOperation(uint8_t /*commandArgument*/) {}
+        void notifySusiMasterAddress(uint16_t /*MasterAddress*/) {}
+        void notifySusiControllModule(uint8_t /*ModuleControll*/) {}
+        void notifySusiUnknownMessage(uint8_t /*firstByte*/, uint8_t /*secondByte*/) {}
+};
+
+/*
+*   SusiWeakCallbacks - weak notifySusi... functions (used by process() without parameter), each one is called only if it is implemented
+*/
+class SusiWeakCallbacks {
+    public:
+        void notifySusiRawMessage(uint8_t firstByte, uint8_t secondByte) { if (::notifySusiRawMessage) {::notifySusiRawMessage(firstByte, secondByte);} }
+        void notifySusiRawMessage3b(uint8_t firstByte, uint8_t secondByte, uint8_t thirdByte) { if (::notifySusiRawMessage3b) {::notifySusiRawMessage3b(firstByte, secondByte, thirdByte);} }
+        void notifySusiFunc(SUSI_FN_GROUP SUSI_FuncGrp, uint8_t SUSI_FuncState) { if (::notifySusiFunc) {::notifySusiFunc(SUSI_FuncGrp, SUSI_FuncState);} }
+        void notifySusiBinaryState(uint8_t Command, uint8_t CommandState) { if (::notifySusiBinaryState) {::notifySusiBinaryState(Command, CommandState);} }
+        void notifySusiBinaryStateL(uint16_t Command, uint8_t CommandState) { if (::notifySusiBinaryStateL) {::notifySusiBinaryStateL(Command, CommandState);} }
+        void notifySusiBinaryStateBroadcast(uint8_t CommandState, uint16_t FirstCommand, uint16_t LastCommand) {
+            if (::notifySusiBinaryStateBroadcast) {                             // one call for all
+                ::notifySusiBinaryStateBroadcast(CommandState, FirstCommand, LastCommand);
+            } else if (LastCommand < 128) {
+                if (::notifySusiBinaryState) {                                  // compatibility - call for each function
+                    for (uint16_t i = FirstCommand; i <= LastCommand; i++) {::notifySusiBinaryState(i, CommandState);}
+                }
+            } else if (::notifySusiBinaryStateL) {                              // compatibility - 0 means broadcast
+                ::notifySusiBinaryStateL(0, CommandState);
+            }
+        }
+        void notifySusiAux(SUSI_AUX_GROUP SUSI_auxGrp, uint8_t SUSI_AuxState) { if (::notifySusiAux) {::notifySusiAux(SUSI_auxGrp, SUSI_AuxState);} }
+        void notifySusiTriggerPulse(uint8_t state) { if (::notifySusiTriggerPulse) {::notifySusiTriggerPulse(state);} }
+        void notifySusiMotorCurrent(int8_t current) { if (::notifySusiMotorCurrent) {::notifySusiMotorCurrent(current);} }
+        void notifySusiRequestSpeed(uint8_t Speed, SUSI_DIRECTION Dir) { if (::notifySusiRequestSpeed) {::notifySusiRequestSpeed(Speed, Dir);} }
+        void notifySusiDCCSpeed(uint8_t Speed, SUSI_DIRECTION Dir) { if (::notifySusiDCCSpeed) {::notifySusiDCCSpeed(Speed, Dir);} }
+        void notifySusiRealSpeed(uint8_t Speed, SUSI_DIRECTION Dir) { if (::notifySusiRealSpeed) {::notifySusiRealSpeed(Speed, Dir);} }
+        void notifySusiMotorLoad(int8_t load) { if (::notifySusiMotorLoad) {::notifySusiMotorLoad(load);} }
+        void notifySusiAnalogFunction(SUSI_AN_GROUP SUSI_AnalogGrp, uint8_t SUSI_AnalogState) { if (::notifySusiAnalogFunction) {::notifySusiAnalogFunction(SUSI_AnalogGrp, SUSI_AnalogState);} }
+        void notifySusiAnalogDirectCommand(uint8_t functionNumber, uint8_t Value) { if (::notifySusiAnalogDirectCommand) {::notifySusiAnalogDirectCommand(functionNumber, Value);} }
+        void notifySusiNoOperation(uint8_t commandArgument) { if (::notifySusiNoOperation) {::notifySusiNoOperation(commandArgument);} }
+        void notifySusiMasterAddress(uint16_t MasterAddress) { if (::notifySusiMasterAddress) {::notifySusiMasterAddress(MasterAddress);} }
+        void notifySusiControllModule(uint8_t ModuleControll) { if (::notifySusiControllModule) {::notifySusiControllModule(ModuleControll);} }
+        void notifySusiUnknownMessage(uint8_t firstByte, uint8_t secondByte) { if (::notifySusiUnknownMessage) {::notifySusiUnknownMessage(firstByte, secondByte);} }
+};
+
+/*
+*   SusiEventCallbacks - callbacks of poll(), every callback stores one SusiEvent (one packet gives one event at most)
+*/
+class SusiEventCallbacks : public SusiCallbacks<SusiEventCallbacks> {
+    private:
+        SusiEvent& Event;
+        void Set(SUSI_EVENT_KIND Kind, uint8_t Group, uint8_t Value, uint16_t Number = 0) {
+            Event.Kind = Kind;
+            Event.Group = Group;
+            Event.Value = Value;
+            Event.Number = Number;
+            Ready = true;
+        }
+    public:
+        bool Ready;                                                             // event was stored
+        SusiEventCallbacks(SusiEvent& Target) : Event(Target), Ready(false) {}
+        void notifySusiFunc(SUSI_FN_GROUP SUSI_FuncGrp, uint8_t SUSI_FuncState) { Set(SUSI_EVENT_FUNC, SUSI_FuncGrp, SUSI_FuncState); }
+        void notifySusiBinaryState(uint8_t Command, uint8_t CommandState) { Set(SUSI_EVENT_BINARY, 0, CommandState, Command); }
+        void notifySusiBinaryStateL(uint16_t Command, uint8_t CommandState) { Set(SUSI_EVENT_BINARY, 0, CommandState, Command); }
+        void notifySusiBinaryStateBroadcast(uint8_t CommandState, uint16_t /*FirstCommand*/, uint16_t LastCommand) { Set(SUSI_EVENT_BINARY_ALL, 0, CommandState, LastCommand); }
+        void notifySusiAux(SUSI_AUX_GROUP SUSI_auxGrp, uint8_t SUSI_AuxState) { Set(SUSI_EVENT_AUX, SUSI_auxGrp, SUSI_AuxState); }
+        void notifySusiTriggerPulse(uint8_t state) { Set(SUSI_EVENT_TRIGGER, 0, state); }
+        void notifySusiMotorCurrent(int8_t current) { Set(SUSI_EVENT_CURRENT, 0, (uint8_t)current); }
+        void notifySusiRequestSpeed(uint8_t Speed, SUSI_DIRECTION Dir) { Set(SUSI_EVENT_REQUEST_SPEED, Dir, Speed); }
+        void notifySusiDCCSpeed(uint8_t Speed, SUSI_DIRECTION Dir) { Set(SUSI_EVENT_DCC_SPEED, Dir, Speed); }
+        void notifySusiRealSpeed(uint8_t Speed, SUSI_DIRECTION Dir) { Set(SUSI_EVENT_REAL_SPEED, Dir, Speed); }
+        void notifySusiMotorLoad(int8_t load) { Set(SUSI_EVENT_LOAD, 0, (uint8_t)load); }
+        void notifySusiAnalogFunction(SUSI_AN_GROUP SUSI_AnalogGrp, uint8_t SUSI_AnalogState) { Set(SUSI_EVENT_ANALOG, SUSI_AnalogGrp, SUSI_AnalogState); }
+        void notifySusiAnalogDirectCommand(uint8_t functionNumber, uint8_t Value) { Set(SUSI_EVENT_ANALOG_DIRECT, functionNumber, Value); }
+        void notifySusiNoOperation(uint8_t commandArgument) { Set(SUSI_EVENT_NOP, 0, commandArgument); }
+        void notifySusiMasterAddress(uint16_t MasterAddress) { Set(SUSI_EVENT_MASTER_ADDRESS, 0, 0, MasterAddress); }
+        void notifySusiControllModule(uint8_t ModuleControll) { Set(SUSI_EVENT_MODULE_CONTROL, 0, ModuleControll); }
+        void notifySusiUnknownMessage(uint8_t firstByte, uint8_t secondByte) { Set(SUSI_EVENT_UNKNOWN, firstByte, secondByte); }
+};
+
+/**********************************************************************************************************************/
+/* Message processor */
+
+template<class Callbacks> int8_t SUSI2::process(Callbacks& Notify) {
+  int8_t ResponseStatus = 0;
+  SusiSlot Slot;                                             // local copy of processed packet
+#ifdef SUSI_USE_DMA
+  DrainReceiver();                                           // tail of burst, DMA interrupt did not come for it
+#endif
+  if (Waiting()) {ResponseStatus = 1;}                       // at minimum one in queue
+  while (PopPacket(Slot))                                    // are data in buffer available?
+  {
+#ifndef SUSI_NO_TIMESTAMPS
+    LastPacketTime = Slot.Time;                              // for lastPacketTime() in callbacks
+#endif
+    if (!DecodePacket(Slot.Packet, Notify)) {ResponseStatus = -1;}   // unknown message in queue
+  }
+#ifdef SUSI_CV_CACHE_SIZE
+  CacheIdle();                                               // programming is finished (or paused), write batch
+#endif
+  return ResponseStatus;
+}
+
+template<class Callbacks> uint16_t SUSI2::process(Callbacks& Notify, uint8_t MaxPackets, uint16_t MaxMicros) {
+  const uint32_t Start = micros();
+  uint8_t Packets = 0;
+  SusiSlot Slot;
+#ifdef SUSI_USE_DMA
+  DrainReceiver();                                           // tail of burst, DMA interrupt did not come for it
+#endif
+  while (PopPacket(Slot)) {
+#ifndef SUSI_NO_TIMESTAMPS
+    LastPacketTime = Slot.Time;                              // for lastPacketTime() in callbacks
+#endif
+    DecodePacket(Slot.Packet, Notify);
+    if ((MaxPackets) && (++Packets >= MaxPackets)) {break;}                               // packet budget used
+    if ((MaxMicros) && ((uint32_t)(micros() - Start) >= MaxMicros)) {break;}              // time budget used
+  }
+  const uint16_t Left = Waiting();                            // new packets could come meanwhile
+#ifdef SUSI_CV_CACHE_SIZE
+  if (Left == 0) {CacheIdle();}                              // flash write only when nothing is waiting
+#endif
+  return Left;
+}
+
+template<class Callbacks> bool SUSI2::DecodePacket(PacketT Packet, Callbacks& Notify) {
+  const uint8_t Command = Packet.B.cmnd;
+  const uint8_t Arg = Packet.B.arg1;
+  const SusiCommand Entry = DecodeStart(Command);           // dispatch table, statistics, pairs
+
+  if ((Command & 0xF0) != 0x70) {
+      Notify.notifySusiRawMessage(Command, Arg);
+  } else {
+      Notify.notifySusiRawMessage3b(Command, Arg, Packet.B.arg2);
+  }
+
+  switch (Entry.Handler) {
+#if SUSI_FEATURES & SUSI_FEATURE_FUNCTIONS
+    case H_FUNC:
+      /*Function group 1 : 0110-0000 (0x60 = 96) 0 0 0 F0 - F4 F3 F2 F1
+        Function group 2 : 0110-0001 (0x61 = 97) F12 F11 F10 F9 - F8 F7 F6 F5
+        ...
+        Function group 9 : 0110-1000 (0x68 = 104) F68 F67 F66 F65 - F64 F63 F62 F61*/
+      if (UpdateState(MIRROR_FN + Entry.Param, Arg)) {
+        Notify.notifySusiFunc(Entry.Param, Arg);
+      }
+      break;
+#endif
+#if SUSI_FEATURES & SUSI_FEATURE_BINARY
+    case H_BINARY_SHORT:
+      /*Binary states short form : 0110-1101 (0x6D = 109) D L6 L5 L4 - L3 L2 L1 L0
+          D = 0 means function L switched off, D = 1 switched on
+          L = function number 1 ... 127
+          L = 0 (broadcast) switches all functions 1 to 127 off (D = 0) or on (D = 1)*/
+      if ((Arg & 0x7F) == 0) {      // L = 0 ?
+          // Broadcast to all functions
+          UpdateBinaryStates((Arg & 0x80) != 0);                           // whole bitmap at once
+          Notify.notifySusiBinaryStateBroadcast((Arg & 0x80) != 0, 1, 127);  // one call for all (or call for each function, see SusiCallbacks)
+      }
+      else {
+          // Command for one function
+          UpdateBinaryState(Arg & 0x7F, (Arg & 0x80) != 0);
+          Notify.notifySusiBinaryState(Arg & 0x7F, (Arg & 0x80) != 0);
+                                     // ^^ Function number             ^^ Function state
+      }
+      break;
+    case H_BINARY_LOW:  // && 0x6F
+      /*Binary states long form low byte : 0110-1110 (0x6E = 110) D L6 L5 L4 - L3 L2 L1 L0
+          The Binary states long form commands are always sent as a pair. This command is sent before
+          the binary state long form high byte. If the two commands do not follow each other directly, they
+          must be ignored.
+          D = 0 means binary state L switched off, D = 1 "switched on"
+          L = low-order bits of binary state number 1 ... 32767
+
+          Binary states long form high byte : 0110-1111 (0x6F = 111) H7 H6 H5 H4 - H3 H2 H1 H0
+          The Binary states long form commands are always sent as a pair. This command is sent after
+          the binary state long form low byte. If the two commands do not follow each other directly, they must
+          be ignored. Only this command leads to the execution of the complete command.
+          H = high-order bits of the binary state number high 1 ... 32767
+          H and L = 0 (broadcast) switches all 32767 available binary states off (D = 0) or on (D = 1)*/
+      LowBinary = Arg;                        // copy low byte for future
+      WaitHighBinary = 1;                     // set waiting flag
+      break;
+    case H_BINARY_HIGH:  // && 0x6E
+      if (WaitHighBinary == 1) {                   // only if previous one was 0x6E
+        WaitHighBinary = 0;                   // remove waiting flag
+        uint16_t BAddress = Arg;
+        BAddress = BAddress << 7;
+        BAddress |= (LowBinary & 0x7F);
+        if (BAddress == 0) {                  // H = L = 0 broadcast for all 32767 states
+          UpdateBinaryStates((LowBinary & 0x80) != 0);
+          Notify.notifySusiBinaryStateBroadcast((LowBinary & 0x80) != 0, 1, 32767);   // (or notifySusiBinaryStateL(0, ...), see SusiCallbacks)
+        }
+        else {
+          if (BAddress < 128) {UpdateBinaryState(BAddress, (LowBinary & 0x80) != 0);}   // the same states as in short form
+          Notify.notifySusiBinaryStateL(BAddress, (LowBinary & 0x80) != 0);
+        }
+      }
+      break;
+#endif
+#if SUSI_FEATURES & SUSI_FEATURE_FUNCTIONS
+    case H_AUX:
+      /*Direct command 1 : 0100-0000 (0x40 = 64) X8 X7 X6 X5 - X4 X3 X2 X1
+          The direct commands are used for direct control of outputs and other functions after
+          interpreting the function (mapping) table in the Host. A bit = 1 means the corresponding output is
+          switched on.
+        Direct command 2 : 0100-0001 (0x41 = 65) X16 X15 X14 X13 - X12 X11 X10 X9
+        Direct command 3 : 0100-0010 (0x42 = 66) X24 X23 X22 X21 – X20 X19 X18 X17
+        Direct command 4 : 0100-0011 (0x43 = 67) X32 X31 X30 X29 - X28 X27 X26 X25 */
+      if (UpdateState(MIRROR_AUX + Entry.Param, Arg)) {
+        Notify.notifySusiAux(Entry.Param, Arg);
+      }
+      break;
+#endif
+#if SUSI_FEATURES & SUSI_FEATURE_MOTION
+    case H_TRIGGER:
+      /*Trigger pulse : 0010-0001 (0x21 = 33) 0 0 0 0 - 0 0 0 1 
+        The command is used for synchronization of a steam impulse. It is sent once per steam pulse. 
+        Bits 1 to 7 are reserved for future applications.*/
+      Notify.notifySusiTriggerPulse(Arg);
+      break;
+    case H_CURRENT:
+      /*Current : 0010-0011 (0x23 = 35) S7 S6 S5 S4 - S3 S2 S1 S0
+        Current consumed by the motor. The value has a range from -128 to 127, is transmitted in 2's 
+        complement and is calibrated by a manufacturer specific CV in the locomotive decoder. Negative 
+        values mean regeneration as it is possible with modern electric locomotives. */
+      Notify.notifySusiMotorCurrent(static_cast<int8_t>(Arg));
+      break;
+    case H_SPEED:
+      /*Locomotive actual speed step : 0010-0100 (0x24 = 36) R G6 G5 G4 - G3 G2 G1 G0
+        The speed step and direction correspond to the real state of the motor. The transmitted G value 
+        is the Vmax of the model normalized to 0…127. G = 0 means the locomotive is stationary, G = 1 ... 
+        127 is the normalized speed, R = direction of travel with R = 0 for reverse and R = 1 for forward. 
+        This and the following command are not recommended for new implementations. SUSI-Modules 
+        should evaluate commands 0x50 to 0x52 if possible. Hosts that use deviating and/or different 
+        implementations for commands 0x24 and 0x25 for compatibility with existing products are compliant 
+        with the standard
+
+        Locomotive target speed step : 0010-0101 (0x25 = 37) R G6 G5 G4 - G3 G2 G1 G0
+        Received speed level of the "Host" normalized to 127 speed levels. G = 0 means locomotive 
+        should stop, G = 1 ... 127 is the normalized speed R = direction of travel with R = 0 for reverse and 
+        R = 1 for forward.
+
+        0x50 = actual speed step, 0x51 = target speed step (the same as 0x24, 0x25)
+
+        DCC speed step : 0101-0010 (0x52 = 82) R G6 G5 G4 - G3 G2 G1 G0
+        This value is only normalized from 14 or 28 speed steps to 127 speed steps if necessary. There 
+        is no adjustment by any CVs.*/
+      if (UpdateState(Entry.Param, Arg)) {
+        const SUSI_DIRECTION Dir = (Arg & 0x80) ? SUSI_DIR_FWD : SUSI_DIR_REV;
+        if (Entry.Param == MIRROR_REAL_SPEED) {Notify.notifySusiRealSpeed(Arg & 0x7F, Dir);}
+        else if (Entry.Param == MIRROR_REQUEST_SPEED) {Notify.notifySusiRequestSpeed(Arg & 0x7F, Dir);}
+        else {Notify.notifySusiDCCSpeed(Arg & 0x7F, Dir);}
+      }
+      break;
+    case H_LOAD:
+      /*Load control : 0010-0110 (0x26 = 38) P7 P6 P5 P4 - P3 P2 P1 P0
+        The load state can be detected by motor voltage, current or power. 0 = no load, 127 = 
+        maximum load. Negative values are also possible, which are transmitted in 2's complement. This 
+        mean less load than driving on flat surface. */
+      Notify.notifySusiMotorLoad(static_cast<int8_t>(Arg));
+      break;
+#endif
+#if SUSI_FEATURES & SUSI_FEATURE_ANALOG
+    case H_ANALOG:
+      /*Analog function group 1 : 0010-1xxx (0x28 = 40 to 0x2F = 47) A7 A6 A5 A4 - A3 A2 A1 A0
+        The eight commands of this group allow the transmission of eight different analog values in 
+        digital mode.*/
+      if (UpdateState(MIRROR_ANALOG + Entry.Param, Arg)) {
+        Notify.notifySusiAnalogFunction(Entry.Param, Arg);
+      }
+      break;
+    case H_ANALOG_DIRECT:
+      /*Direct command 1 for analog operation : 0011-0000 (0x30 = 48) D7 D6 D5 D4 - D3 D2 D1 D0 
+         Setting of basic functions in analog mode bypassing a function assignment. 
+          Bit 0: Sound on/off 
+          Bit 1: Up/break 
+          Bit 2-6: Reserved 
+          Bit 7: Reduced volume
+        Direct command 2 for analog operation : 0011-0000 (0x31 = 49) D7 D6 D5 D4 - D3 D2 D1 D0
+         Setting of basic functions in analog mode bypassing a function assignment. 
+          Bit 0: Front light 
+          Bit 1: Rear light 
+          Bit 2: Parking light 
+          Bit 3-7: Reserved*/
+      Notify.notifySusiAnalogDirectCommand(Entry.Param, Arg);
+      break;
+#endif
+#if SUSI_FEATURES & SUSI_FEATURE_CONTROL
+    case H_NOP:
+      /*No Operation : 0000-0000 (0x00 = 0) X X X X - X X X X
+         The command does not cause any action in the SUSI-Module. The data can have any value. 
+         The command can be used as a gap filler or for test purposes. */
+      Notify.notifySusiNoOperation(Arg);
+      break;
+    case H_ADDRESS_LOW:  // && 0x5F
+      /*Module address low : 0101-1110 (0x5E = 94) A7 A6 A5 A4 - A3 A2 A1 A0
+          Transmits the least significant bits of the active digital address of the "Host" when it is in a 
+          digital operating mode. The command is always sent in pairs before the address high byte. If the two 
+          commands do not follow each other directly, they are to be ignored. */
+      LowBinary = Arg;                        // copy low byte for future
+      WaitHighBinary = 2;                     // set waiting flag
+      break;
+    case H_ADDRESS_HIGH:  // && 0x5E
+      if (WaitHighBinary == 2) {                   // only if previous one was 0x5E
+        WaitHighBinary = 0;                   // remove waiting flag
+        uint16_t BAddress = Arg;
+        BAddress = BAddress << 8;
+        BAddress |= LowBinary;
+        Notify.notifySusiMasterAddress(BAddress);
+      }
+      break;
+    case H_MODULE_CONTROL:
+      /*Module control byte : 0110-1100 (0x6C = 108) B7 B6 B5 B4 - B3 B2 B1 B0 
+          Bit 0 = Buffer Control: 0 = Buffer off, 1 = Buffer on 
+          Bit 1 = Reset function: 0 = set all functions to "Off", 1 = normal operation 
+          All other bits reserved by the RailCommunity. 
+          If implemented, bits 0 and 1 must be set to 1 in the SUSI-Module after a reset. */
+      Notify.notifySusiControllModule(Arg);
+      break;
+#endif
+#if SUSI_FEATURES & SUSI_FEATURE_CV
+    case H_CV_CHECK:
+    case H_CV_BIT:
+    case H_CV_RESET:
+    case H_CV_WRITE:
+      DecodeCV(Entry.Handler, Packet);                       // CV storage is accessed by weak callbacks
+      break;
+#endif
+#ifdef SUSI_USE_BIDI
+    case H_BIDI:                                             // answer was sent by BiDiTransmit(), nothing more to do
+      break;
+#endif
+    default:
+      SUSI_COUNT(Unknown);
+      Notify.notifySusiUnknownMessage(Command, Arg);         // notify about unknowns...
+      return false;
+  }
+  return true;
+}
+
+#endif
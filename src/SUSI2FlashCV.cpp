@@ -0,0 +1,161 @@
+/*
+  Wear levelled CV storage in flash for SUSI2 library
+
+  Page layout (SUSI_FLASH_PAGE_SIZE bytes):
+    word 0          header: 0x5355 (SU) in upper half, sequence number in lower half
+    word 1 .. n     records, one per CV write, in order of writes (later record wins)
+
+  Record (32 bits): check(8) | 0 | CV(7) | index(8) | value(8), check = CV ^ index ^ value ^ 0xA5
+  Erased flash (any pattern) and torn writes do not pass the check, then no "erased" value is needed.
+  Header of new page is written after its records, then interrupted compaction leaves old page active.
+
+  Created by Jindra Fucik / https://www.fucik.name
+*/
+
+#include "SUSI2FlashCV.h"
+
+#define FLASH_CV_MAGIC          0x5355                                       // "SU"
+#define FLASH_CV_CHECK          0xA5
+
+static uint32_t MakeRecord(uint8_t CV, uint8_t Index, uint8_t Value) {
+  uint8_t Check = CV ^ Index ^ Value ^ FLASH_CV_CHECK;
+  return ((uint32_t)Check << 24) | ((uint32_t)(CV & 0x7F) << 16) | ((uint32_t)Index << 8) | Value;
+}
+
+static bool ValidRecord(uint32_t Record) {
+  if (Record & 0x00800000) {return false;}                                  // bit 23 is always 0
+  uint8_t Check = (uint8_t)(Record >> 16) ^ (uint8_t)(Record >> 8) ^ (uint8_t)Record ^ FLASH_CV_CHECK;
+  return Check == (uint8_t)(Record >> 24);
+}
+
+static bool ValidHeader(uint32_t Header) {
+  return (Header >> 16) == FLASH_CV_MAGIC;
+}
+
+uint8_t SUSI2FlashCV::Find(uint8_t CV, uint8_t Index) {
+  for (uint8_t i = 0; i < Keys; i++) {
+    if ((KeyCV[i] == CV) && (KeyIndex[i] == Index)) {return i;}
+  }
+  return SUSI_FLASH_CV_KEYS;
+}
+
+bool SUSI2FlashCV::Store(uint8_t CV, uint8_t Index, uint8_t Value) {
+  uint8_t i = Find(CV, Index);
+  if (i == SUSI_FLASH_CV_KEYS) {
+    if (Keys == SUSI_FLASH_CV_KEYS) {return false;}                         // RAM index is full
+    i = Keys++;
+    KeyCV[i] = CV;
+    KeyIndex[i] = Index;
+  }
+  KeyValue[i] = Value;
+  return true;
+}
+
+bool SUSI2FlashCV::Append(uint32_t Record) {
+  while (WritePos < SUSI_FLASH_RECORDS) {
+    uint32_t Address = PageAddress(ActivePage) + 4 + (uint32_t)WritePos * 4;
+    WritePos++;
+    if (susiFlashProgram(Address, Record)) {return true;}                   // torn write from the past is skipped
+  }
+  return false;                                                             // page is full
+}
+
+bool SUSI2FlashCV::Format(uint8_t Page) {
+  if (!susiFlashErase(PageAddress(Page))) {return false;}
+  uint8_t OldPage = ActivePage;
+  uint16_t OldPos = WritePos;
+  ActivePage = Page;
+  WritePos = 0;
+  for (uint8_t i = 0; i < Keys; i++) {                                      // actual values first ..
+    if (!Append(MakeRecord(KeyCV[i], KeyIndex[i], KeyValue[i]))) {ActivePage = OldPage; WritePos = OldPos; return false;}
+  }
+  if (!susiFlashProgram(PageAddress(Page), ((uint32_t)FLASH_CV_MAGIC << 16) | (uint16_t)(Sequence + 1))) {   // .. then header makes page valid
+    ActivePage = OldPage;
+    WritePos = OldPos;
+    return false;
+  }
+  Sequence++;
+  return true;
+}
+
+void SUSI2FlashCV::begin(void) {
+  Started = true;
+  Keys = 0;
+  bool Found = false;
+  for (uint8_t Page = 0; Page < SUSI_FLASH_CV_PAGES; Page++) {              // newest valid page is active
+    uint32_t Header = susiFlashRead(PageAddress(Page));
+    if (!ValidHeader(Header)) {continue;}
+    uint16_t PageSequence = (uint16_t)Header;
+    if ((!Found) || ((int16_t)(PageSequence - Sequence) > 0)) {             // sequence can wrap
+      Found = true;
+      ActivePage = Page;
+      Sequence = PageSequence;
+    }
+  }
+  if (!Found) {                                                             // empty (new) flash
+    Sequence = 0;
+    ActivePage = 0;
+    WritePos = 0;
+    Format(0);
+    return;
+  }
+  WritePos = 0;
+  for (uint16_t i = 0; i < SUSI_FLASH_RECORDS; i++) {                       // replay log to RAM index
+    uint32_t Record = susiFlashRead(PageAddress(ActivePage) + 4 + (uint32_t)i * 4);
+    if (!ValidRecord(Record)) {continue;}
+    Store((uint8_t)(Record >> 16), (uint8_t)(Record >> 8), (uint8_t)Record);
+    WritePos = i + 1;                                                       // append after last valid record
+  }
+}
+
+uint8_t SUSI2FlashCV::read(uint8_t CV, uint8_t Index, uint8_t Default) {
+  if (!Started) {begin();}
+  uint8_t i = Find(CV & 0x7F, Index);
+  if (i == SUSI_FLASH_CV_KEYS) {return Default;}                            // never written
+  return KeyValue[i];
+}
+
+uint8_t SUSI2FlashCV::write(uint8_t CV, uint8_t Index, uint8_t Value) {
+  if (!Started) {begin();}
+  CV &= 0x7F;
+  uint8_t i = Find(CV, Index);
+  if ((i != SUSI_FLASH_CV_KEYS) && (KeyValue[i] == Value)) {return Value;}  // the same value, no flash write
+  if ((i == SUSI_FLASH_CV_KEYS) && (Keys == SUSI_FLASH_CV_KEYS)) {return ~Value;}   // no room in RAM index, write fails
+  bool New = (i == SUSI_FLASH_CV_KEYS);
+  uint8_t Old = New ? (uint8_t)~Value : KeyValue[i];
+  Store(CV, Index, Value);
+  if (!Append(MakeRecord(CV, Index, Value))) {                              // page is full, compaction writes new value too
+    if (!Format((ActivePage + 1) % SUSI_FLASH_CV_PAGES)) {                  // flash failed, RAM index is returned back:
+      if (New) {Keys--;}                                                    // new CV (added last) is forgotten,
+      else {KeyValue[i] = Old;}                                             // stored CV keeps old value
+      return Old;
+    }
+  }
+  return Value;
+}
+
+void SUSI2FlashCV::clear(void) {
+  if (!Started) {begin();}
+  Keys = 0;
+  Format((ActivePage + 1) % SUSI_FLASH_CV_PAGES);                           // new empty page, old one is not valid any more ..
+  for (uint8_t Page = 0; Page < SUSI_FLASH_CV_PAGES; Page++) {
+    if (Page != ActivePage) {susiFlashErase(PageAddress(Page));}            // .. and it is erased
+  }
+}
+
+#ifdef SUSI_USE_FLASH_CV
+/**********************************************************************************************************************/
+/* Default CV storage for SUSI2 */
+
+SUSI2FlashCV SusiFlashCV;
+
+uint8_t notifySusiCVRead(uint8_t CV, uint8_t CVindex) __attribute__((weak));
+uint8_t notifySusiCVRead(uint8_t CV, uint8_t CVindex) {
+  return SusiFlashCV.read(CV, CVindex);
+}
+
+uint8_t notifySusiCVWrite(uint8_t CV, uint8_t CVindex, uint8_t Value) __attribute__((weak));
+uint8_t notifySusiCVWrite(uint8_t CV, uint8_t CVindex, uint8_t Value) {
+  return SusiFlashCV.write(CV, CVindex, Value);
+}
+#endif
@@ -0,0 +1,143 @@
+/*
+  Wear levelled CV storage in flash for SUSI2 library
+
+  CH32V003 has no EEPROM, emulated one gives only 26 bytes and rewrites the page on every commit().
+  This store keeps CVs as append-only log of (CV, index, value) records in reserved flash pages:
+  - write of CV appends one 4 byte record (no erase), write of the same value does nothing
+  - when page is full, actual values are copied to next page (compaction) - one erase per ~250 writes
+  - at start log is scanned and RAM index of actual values is built, then read is RAM only
+
+  Flash primitives (susiFlashErase, susiFlashProgram, susiFlashRead) are in hardware backend
+  (SUSI2_CH32.cpp, or extras/host/SUSI2_Sim.cpp with emulated flash).
+
+  Created by Jindra Fucik / https://www.fucik.name
+*/
+
+#ifndef SUSI2_FLASH_CV_H
+#define SUSI2_FLASH_CV_H
+
+#include "SUSI2.h"
+
+/* Reserved flash - must not be used by program (check size of sketch!) */
+// Default is last 2 KB of 16 KB flash of CH32V003. Can be changed by build flags.
+#ifndef SUSI_FLASH_PAGE_SIZE
+#define SUSI_FLASH_PAGE_SIZE        1024                                                                                    // erase unit in bytes
+#endif
+#ifndef SUSI_FLASH_CV_PAGES
+#define SUSI_FLASH_CV_PAGES         2                                                                                       // amount of pages used for log (2 .. 255)
+#endif
+#ifndef SUSI_FLASH_CV_BASE
+#define SUSI_FLASH_CV_BASE          (0x08004000 - SUSI_FLASH_CV_PAGES * SUSI_FLASH_PAGE_SIZE)                               // address of first page
+#endif
+#ifndef SUSI_FLASH_CV_KEYS
+#define SUSI_FLASH_CV_KEYS          64                                                                                      // max amount of different (CV, index) stored - 3 bytes of RAM each
+#endif
+
+#define SUSI_FLASH_RECORDS          ((SUSI_FLASH_PAGE_SIZE - 4) / 4)                                                        // records per page (first word is page header)
+
+/*
+*   Flash primitives - implemented by hardware backend
+*/
+bool susiFlashErase(uint32_t Address);                                      // erase page at address, true = done
+bool susiFlashProgram(uint32_t Address, uint32_t Data);                     // program one erased word, true = verified
+uint32_t susiFlashRead(uint32_t Address);                                   // read one word
+
+class SUSI2FlashCV {
+    static_assert(SUSI_FLASH_CV_KEYS < SUSI_FLASH_RECORDS, "all CVs must fit to one page after compaction");
+    static_assert((SUSI_FLASH_CV_PAGES >= 2) && (SUSI_FLASH_CV_PAGES <= 255), "SUSI_FLASH_CV_PAGES must be 2 .. 255");
+
+    private:
+        uint8_t KeyCV[SUSI_FLASH_CV_KEYS];                                  // RAM index - CV number
+        uint8_t KeyIndex[SUSI_FLASH_CV_KEYS];                               // RAM index - CV index
+        uint8_t KeyValue[SUSI_FLASH_CV_KEYS];                               // RAM index - actual value
+        uint8_t Keys;                                                       // used entries of RAM index
+        uint8_t ActivePage;                                                 // page with actual log
+        uint16_t Sequence;                                                  // sequence number of active page (newer page has higher one)
+        uint16_t WritePos;                                                  // next record in active page
+        bool Started;                                                       // begin() done
+
+    private:
+        /*
+        *   PageAddress() Address of page
+        */
+        uint32_t PageAddress(uint8_t Page) { return SUSI_FLASH_CV_BASE + (uint32_t)Page * SUSI_FLASH_PAGE_SIZE; }
+        /*
+        *   Find() Position of (CV, index) in RAM index
+        *   Returns:
+        *       - position, or SUSI_FLASH_CV_KEYS if not stored
+        */
+        uint8_t Find(uint8_t CV, uint8_t Index);
+        /*
+        *   Store() Update RAM index
+        *   Returns:
+        *       - true = stored, false = RAM index is full
+        */
+        bool Store(uint8_t CV, uint8_t Index, uint8_t Value);
+        /*
+        *   Append() Append record to active page
+        *   Returns:
+        *       - true = written, false = page is full
+        */
+        bool Append(uint32_t Record);
+        /*
+        *   Format() Erase page and make it active with next sequence number, write all values from RAM index
+        *   Returns:
+        *       - true = done
+        */
+        bool Format(uint8_t Page);
+
+    public:
+        SUSI2FlashCV(void) : Keys(0), ActivePage(0), Sequence(0), WritePos(0), Started(false) {}
+        /*
+        *   begin() Find active page and build RAM index. It is called automatically by first read / write.
+        *   Input:
+        *       - None
+        *   Returns:
+        *       - None
+        */
+        void begin(void);
+        /*
+        *   read() Read CV (RAM only)
+        *   Input:
+        *       - CV number relative to 897 (the same as in notifySusiCVRead)
+        *       - CV index
+        *       - value returned for CV never written
+        *   Returns:
+        *       - CV value
+        */
+        uint8_t read(uint8_t CV, uint8_t Index, uint8_t Default = 0xFF);
+        /*
+        *   write() Write CV (one record appended, nothing written if value is the same)
+        *   Input:
+        *       - CV number relative to 897 (the same as in notifySusiCVWrite)
+        *       - CV index
+        *       - new value
+        *   Returns:
+        *       - value read back (differs from new value, when flash failed or SUSI_FLASH_CV_KEYS are used already) - then no ACK is sent
+        */
+        uint8_t write(uint8_t CV, uint8_t Index, uint8_t Value);
+        /*
+        *   clear() Forget all CVs (for example factory reset in notifyCVResetFactoryDefault)
+        *   Input:
+        *       - None
+        *   Returns:
+        *       - None
+        */
+        void clear(void);
+        /*
+        *   freeRecords() Amount of writes possible before next compaction (erase)
+        *   Input:
+        *       - None
+        *   Returns:
+        *       - free records in active page
+        */
+        uint16_t freeRecords(void) { return SUSI_FLASH_RECORDS - WritePos; }
+};
+
+#ifdef SUSI_USE_FLASH_CV
+// With SUSI_USE_FLASH_CV defined (build flag -DSUSI_USE_FLASH_CV) library implements notifySusiCVRead / notifySusiCVWrite
+// by this store (weak - own implementation in sketch has priority). Object is available for sketch, for example for clear().
+extern SUSI2FlashCV SusiFlashCV;
+#endif
+
+#endif
@@ -0,0 +1,521 @@
+/*
+  SUSI / RCN-600 hardware backend for CH32V003
+
+  SPI1 receive (interrupt or DMA), Timer1 gap reset, Timer2 ACK pulse.
+  Protocol decoding itself is in SUSI2.cpp, framing of bytes to packets is inline in SUSI2.h.
+  For host build this file is replaced by extras/host/SUSI2_Sim.cpp.
+
+  Created by Jindra Fucik / https://www.fucik.name
+*/
+
+#include "SUSI2.h"                                                                                 // Header
+#include "SUSI2FlashCV.h"                                                                          // Flash primitives for CV store
+
+#ifdef  TIM_MODULE_ENABLED
+#include <HardwareTimer.h>                                                    // Include HardwareTimer for compatibility
+HardwareTimer myTimer(TIM1);                                                  // define object, to present we occupy Timer 1
+HardwareTimer ackTimer(TIM2);                                                 // define object, to present we occupy Timer 2 (ACK pulse)
+#endif
+
+static_assert(SUSI_SPI == 1, "CH32V003 backend supports SPI1 only (SPI1_IRQHandler, DMA1 channel 2, PC5 / PC6)");
+
+volatile SUSI_ACK_STATUS AckStatus;                                           // Status of ACK pulse - finished in ISR routine
+#ifdef SUSI_USE_DMA
+static_assert((SUSI_DMA_BUFFER_SIZE >= 2) && (SUSI_DMA_BUFFER_SIZE <= 254) && ((SUSI_DMA_BUFFER_SIZE & 1) == 0),
+              "SUSI_DMA_BUFFER_SIZE must be even (2 .. 254), positions in buffer are 8 bit");
+uint8_t DMABuffer[SUSI_DMA_BUFFER_SIZE];                                      // circular buffer filled by DMA from SPI1
+uint8_t DMARead;                                                              // position of first not yet framed byte in DMABuffer
+#endif
+
+SUSI2::~SUSI2(void) {                                                                                   // Class Destructor
+  if (SusiPort<SUSI_SPI>::Bus != this) {return;}                                                        // peripherals are not used by this object
+  StopReceiver();                                                                                       // no more interrupts to this object ..
+  SPI_Cmd( SPI1, DISABLE );                                                                             // stop SPI receiver
+#ifdef SUSI_USE_DMA
+  DMA_Cmd( DMA1_Channel2, DISABLE );                                                                    // stop DMA transfers
+#endif
+  TIM_Cmd( TIM1, DISABLE );                                                                             // stop Timer1 functions
+  TIM_Cmd( TIM2, DISABLE );                                                                             // stop Timer2 (ACK pulse)
+  SusiPort<SUSI_SPI>::Bus = 0;                                                                          // .. then handlers never see null object
+}
+
+/**********************************************************************************************************************/
+/* Interrupts */
+/* interrupts are not member of class, they work with object bound by SusiPort<SUSI_SPI> (set in init) */
+
+#ifdef SUSI_USE_DMA
+/*********************************************************************
+ * @fn      DrainDMA
+ * @brief   Frame all bytes, that DMA stored to circular buffer since last call.
+ * @return  none
+ */
+static inline void DrainDMA(void)
+{
+  SUSI2* Bus = SusiPort<SUSI_SPI>::Bus;                          // load object once for all bytes
+  uint8_t DMAWrite = SUSI_DMA_BUFFER_SIZE - DMA1_Channel2->CNTR;  // DMA counts remaining transfers down
+  if (DMAWrite >= SUSI_DMA_BUFFER_SIZE) {DMAWrite = 0;}         // counter just reloaded (circular mode)
+  while (DMARead != DMAWrite) {
+    Bus->ReceiveByte(DMABuffer[DMARead]);
+    if (++DMARead == SUSI_DMA_BUFFER_SIZE) {DMARead = 0;}       // rotate cyrcular pointer
+  }
+}
+#endif
+
+// Interrupt functions must have "C" linkage!!!
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef SUSI_USE_DMA
+void DMA1_Channel2_IRQHandler(void) __attribute__((interrupt("WCH-Interrupt-fast")));
+/*********************************************************************
+ * @fn      DMA1_Channel2_IRQHandler
+ * @brief   This function handles DMA half transfer and transfer complete of SPI1 received bytes.
+ * @return  none
+ */
+void DMA1_Channel2_IRQHandler(void)
+{
+  DMA_ClearITPendingBit( DMA1_IT_GL2 );      // reset all interrupt flags of channel (HT + TC)
+  DrainDMA();                                // frame received bytes
+  if (SPI1->STATR & SPI_I2S_FLAG_OVR) {      // byte lost (DMA was late), this read after DMA read of DATAR clears the flag
+    SusiPort<SUSI_SPI>::Bus->OverrunReceiver();   // lost byte was somewhere in drained ones, rest until CV packet or gap is discarded
+  }
+}
+#else
+void SPI1_IRQHandler(void) __attribute__((interrupt("WCH-Interrupt-fast")));
+/*********************************************************************
+ * @fn      SPI1_IRQHandler
+ * @brief   This function handles SPI1 received byte.
+ * @return  none
+ */
+void SPI1_IRQHandler(void)
+{
+  uint16_t Status = SPI1->STATR;               // overrun flag must be read before data
+#ifdef SUSI_USE_BIDI
+  uint8_t Data = SPI_I2S_ReceiveData( SPI1 );  // read data (clears interrupt)
+  SPI1->DATAR = SusiPort<SUSI_SPI>::Bus->BiDiTransmit( Data );   // load answer (or idle) before first clock of next byte
+  SusiPort<SUSI_SPI>::Bus->ReceiveByte( Data );                   // and frame it
+#else
+  SusiPort<SUSI_SPI>::Bus->ReceiveByte( SPI_I2S_ReceiveData( SPI1 ) );  // read data (clears interrupt) and frame it
+#endif
+  if (Status & SPI_I2S_FLAG_OVR) {             // byte following the read one was lost
+    SusiPort<SUSI_SPI>::Bus->OverrunReceiver();  // drop its packet and resynchronize
+    (void)SPI1->STATR;                         // read of DATAR + STATR clears overrun flag
+  }
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef  TIM_MODULE_ENABLED
+/*********************************************************************
+ * @fn      timerHandler
+ * @brief   This function handles TIM1 UP exception (reset of communication).
+ * @return  none
+ */
+void timerHandler(void)
+#else
+extern "C" {                                        // Interrupt functions must have "C" linkage!!!
+void TIM1_UP_IRQHandler(void) __attribute__((interrupt("WCH-Interrupt-fast")));
+
+/*********************************************************************
+ * @fn      TIM1_UP_IRQHandler
+ * @brief   This function handles TIM1 UP exception (reset of communication).
+ * @return  none
+ */
+void TIM1_UP_IRQHandler(void)
+#endif
+
+{
+#ifdef SUSI_USE_DMA
+    DrainDMA();                                     // frame rest of bytes received before gap
+#endif
+    SPI1->CTLR1 |= SPI_NSSInternalSoft_Set ;        // initialize SPI receiver by pulse of SS bit (internal one)
+    SPI1->CTLR1 &= SPI_NSSInternalSoft_Reset;       // bo back to active state
+#ifdef SUSI_USE_BIDI
+    SPI1->DATAR = SUSI_BIDI_IDLE;                   // no answer in first byte after gap
+#endif
+    TIM_ClearITPendingBit( TIM1, TIM_IT_Update );   // reset interrupt flag
+    SusiPort<SUSI_SPI>::Bus->GapReceiver();         // reset counter of bytes and empty partially received data
+}
+#ifdef  TIM_MODULE_ENABLED
+#else
+}                                                   // end of extern
+#endif
+
+#ifdef  TIM_MODULE_ENABLED
+/*********************************************************************
+ * @fn      ackHandler
+ * @brief   This function handles TIM2 UP exception (end of ACK pulse).
+ * @return  none
+ */
+void ackHandler(void)
+#else
+extern "C" {                                        // Interrupt functions must have "C" linkage!!!
+void TIM2_IRQHandler(void) __attribute__((interrupt("WCH-Interrupt-fast")));
+
+/*********************************************************************
+ * @fn      TIM2_IRQHandler
+ * @brief   This function handles TIM2 UP exception (end of ACK pulse).
+ * @return  none
+ */
+void TIM2_IRQHandler(void)
+#endif
+
+{
+#ifdef  TIM_MODULE_ENABLED
+    ackTimer.pause();                               // one pulse only
+#else
+    TIM_ClearITPendingBit( TIM2, TIM_IT_Update );   // reset interrupt flag (counter is already stopped by one pulse mode)
+#endif
+    pinMode(SPI_MOSI,INPUT);                        // change pin back to input = release data line
+    AckStatus = SUSI_ACK_DONE;                      // pulse finished
+}
+#ifdef  TIM_MODULE_ENABLED
+#else
+}                                                   // end of extern
+#endif
+
+/**********************************************************************************************************************/
+/* Hardware inits */
+// SUSI clock is on PC5 (SPI1 SCK), data on PC6 (SPI1 MOSI). With SUSI_USE_BIDI answers go out on PC7 (SPI1 MISO, open drain),
+// then PC7 must be strapped to PC6 on the board - SPI1 of CH32V003 can not transmit on MOSI pin.
+
+void SUSI2::initSPI() {
+  /*
+  R16_SPI_CTLR1             // 0x40013000 SPI Control register1
+
+              0000 0110 1100 0001 = 0x06C1
+                                1: Data sampling starts from the second clock edge.
+                               0: SCK is held low in idle state.
+                              0: Configured as a slave device.
+                          00 0: FHCLK /2;
+                         1: Enable SPI.
+                        1: LSB is transmitted first.
+                      0: NSS is low.
+                     1: Software control of the NSS pins.
+                    1: Receive only, simplex mode.
+                   0: Use 8-bit data length for sending and receiving.
+                 0: Continue to send data from the data register.
+                0: CRC calculation is disabled.
+               0: Disable output, receive only.
+              0: Selection of 2-line bi-directional mode.
+
+ 
+
+R16_SPI_CTLR2             // 0x40013004 SPI Control register2
+
+              0000 0000 0100 0000
+                                0：Disable Rx buffer DMA.
+                               0：Disable Tx buffer DMA.
+                              0: Disable SS output in Master mode.
+                           0 0 Reserved
+                          0 Error interrupt disable.
+                         1 RX buffer not empty interrupt enable.
+                        0 Tx buffer empty interrupt disable.
+              0000 0000 Reserved
+
+ 
+
+R16_SPI_STATR              // 0x40013008 SPI Status register
+
+              Read only - bit 0 = received byte
+
+R16_SPI_DATAR             // 0x4001300C SPI Data register
+
+              received data (read clears bit 0 of STATR)
+
+
+SPI1->CTLR1 |= CTLR1_SPE_Set;
+
+ */
+
+    SPI_InitTypeDef SPI_InitStructure={0};
+
+    RCC_APB2PeriphClockCmd(  RCC_APB2Periph_SPI1, ENABLE ); // do not forget clock
+
+#ifdef SUSI_USE_DMA
+    DMARead=0;            // DMA starts at beginning of buffer
+    initDMA();            // initialize DMA before SPI, to not lose first byte
+#endif
+
+    pinMode(SPI_SCK,INPUT); // SUSI data
+    pinMode(SPI_MOSI,INPUT); // SUSI clock
+#ifdef SUSI_USE_BIDI
+    {
+      // BiDi answer is shifted out on MISO - open drain, then it only pulls data line low for 0 bits (like ACK pulse),
+      // PC7 must be connected to SUSI data line (PC6)
+      GPIO_InitTypeDef GPIO_InitStructure={0};
+      RCC_APB2PeriphClockCmd( RCC_APB2Periph_GPIOC, ENABLE );
+      GPIO_InitStructure.GPIO_Pin = GPIO_Pin_7;
+      GPIO_InitStructure.GPIO_Mode = GPIO_Mode_AF_OD;
+      GPIO_InitStructure.GPIO_Speed = GPIO_Speed_30MHz;
+      GPIO_Init( GPIOC, &GPIO_InitStructure );
+    }
+#else
+    //pinMode(SPI_MISO,GPIO_Mode_AF_PP);    // not used
+#endif
+    //pinMode(SPI_CS,INPUT);     // not used
+
+
+
+#define SPI_FirstBit_LSB  ((uint16_t)0x0080)      // not defined in default header
+
+// SPI parameters to fit SUSI requirements
+#ifdef SUSI_USE_BIDI
+    SPI_InitStructure.SPI_Direction = SPI_Direction_2Lines_FullDuplex;   // receive on MOSI, answer on MISO
+#else
+    SPI_InitStructure.SPI_Direction = SPI_Direction_2Lines_RxOnly;
+#endif
+    SPI_InitStructure.SPI_Mode = SPI_Mode_Slave;
+    SPI_InitStructure.SPI_DataSize = SPI_DataSize_8b;
+    SPI_InitStructure.SPI_CPOL = SPI_CPOL_Low;
+    SPI_InitStructure.SPI_CPHA = SPI_CPHA_2Edge;
+    SPI_InitStructure.SPI_NSS = SPI_NSS_Soft;
+    SPI_InitStructure.SPI_BaudRatePrescaler = SPI_BaudRatePrescaler_256;
+    SPI_InitStructure.SPI_FirstBit = SPI_FirstBit_LSB;
+    SPI_InitStructure.SPI_CRCPolynomial = 7;
+    SPI_Init( SPI1, &SPI_InitStructure );
+
+#ifdef SUSI_USE_DMA
+// every received byte is moved by DMA, no SPI interrupt at all
+    SPI_I2S_DMACmd( SPI1, SPI_I2S_DMAReq_Rx, ENABLE );     // RX buffer DMA enable
+#else
+// Enable interrupt on interrupt controller
+    NVIC_EnableIRQ(SPI1_IRQn);
+
+// set interrupt for new packet received
+    SPI_I2S_ITConfig( SPI1, SPI_I2S_IT_RXNE , ENABLE );     //RX buffer not empty interrupt enable bit. Used to generate an interrupt request when the RXNE flag is set. 
+#endif
+
+#ifdef SUSI_USE_BIDI
+    SPI1->DATAR = SUSI_BIDI_IDLE;       // data line released until first answer
+#endif
+
+// Enable SPI
+    SPI_Cmd( SPI1, ENABLE );
+
+
+  //SPI_CTLR1 = 0x06C1;
+}
+
+void SUSI2::StopReceiver() {
+#ifdef SUSI_USE_DMA
+    NVIC_DisableIRQ(DMA1_Channel2_IRQn);            // no framing by DMA interrupt
+#else
+    NVIC_DisableIRQ(SPI1_IRQn);                     // no framing by SPI interrupt
+#endif
+    NVIC_DisableIRQ(TIM1_UP_IRQn);                  // no reset of receiver by gap
+}
+
+#ifdef SUSI_USE_DMA
+void SUSI2::initDMA() {
+    // On CH32V003 is SPI1_RX request connected to DMA1 channel 2.
+    // Channel runs in circular mode, then it never stops. Half transfer and transfer complete interrupts are used for framing,
+    // rest of bytes (packet shorter than half of buffer) is framed by Timer1 gap interrupt.
+    DMA_InitTypeDef DMA_InitStructure={0};
+
+    RCC_AHBPeriphClockCmd( RCC_AHBPeriph_DMA1, ENABLE );   // do not forget clock
+
+    DMA_DeInit( DMA1_Channel2 );
+    DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&SPI1->DATAR;
+    DMA_InitStructure.DMA_MemoryBaseAddr = (uint32_t)DMABuffer;
+    DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralSRC;
+    DMA_InitStructure.DMA_BufferSize = SUSI_DMA_BUFFER_SIZE;
+    DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+    DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+    DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+    DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+    DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
+    DMA_InitStructure.DMA_Priority = DMA_Priority_VeryHigh;
+    DMA_InitStructure.DMA_M2M = DMA_M2M_Disable;
+    DMA_Init( DMA1_Channel2, &DMA_InitStructure );
+
+    DMA_ClearITPendingBit( DMA1_IT_GL2 );                  // clear potential interrupt flags from the past
+    DMA_ITConfig( DMA1_Channel2, DMA_IT_HT | DMA_IT_TC, ENABLE );   // half transfer + transfer complete
+    NVIC_EnableIRQ(DMA1_Channel2_IRQn);                     // enable DMA interrupt on controller
+
+    DMA_Cmd( DMA1_Channel2, ENABLE );
+}
+#endif
+
+void SUSI2::initTimer1() {     // Timer 1 in "slave" mode.
+
+    // the trick is, that timer receive "reset" every falling edge of ETR pin, and ETR pin is shared with SUSI clock.
+    // it mean, timer count 7 miliseconds from last click. After this it reset receiver.
+    // It requiere good configuration of slave mode register. I did not found it in default HAL setup, then I decided to use direct hex values. Sorry
+
+    //pinMode(SPI_SCK,INPUT); // SUSI data - already done in SPI
+
+
+#ifdef  TIM_MODULE_ENABLED
+    myTimer.setOverflow(GapTime, MICROSEC_FORMAT); // 7 milisecond reset rate     This part is for HardwareTimer compatibility only
+    myTimer.attachInterrupt(timerHandler);                                     // This part is for HardwareTimer compatibility only
+#else
+    RCC_APB2PeriphClockCmd(RCC_APB2Periph_TIM1, ENABLE );   // enable clock for timer
+#endif
+
+//R16_TIM1_CTLR1  Control register 1
+// 0000 0000 0000 0100 = 0x0004
+//                   0 - Enables the counter. -> this is enabled afterwards by TIM_Cmd
+//                  0 - 0: UEV is allowed. update (UEV) events are generated by any of the following events: -Counter overflow/underflow ..
+//                 1 - 1: If an update interrupt is enabled, only an update interrupt is generated if the counter overflows/underflows. 
+//                0 - 0: The counter does not stop when the next update event occurs.  --> that is questionable, I nave nultiple resets every 7 ms. It can be useful  can be only one.
+//              0 - 0: the counter's counting mode is incremental. 
+//            00 - 00: Edge-aligned mode. The counter counts up or down based on the direction bit (DIR). 
+//           0 - 0: Auto Reload Value Register (ATRLR) is disabled. 
+//        00 - 00: Tdts=Tck_int (no time divider 1:1)
+//   00 00 - reserved
+//  0 - 0: The capture value is the value of the actual counter 
+// 0 - 0: Disable the indication function
+
+// R16_TIM1_SMCFGR - Slave mode control register 
+// 1000 0000 0111 0100 = 0x8074
+//                 100 - 100: reset mode, where the rising edge of the trigger input (TRGI) will initialize the counter and generate a signal to update the registers. 
+//                0 - reserved
+//            111 - 111: External trigger input (ETRF). 
+//           0 - 0: Does not function. 
+//      0000 - 0000: No externally triggered filtering
+//   00 - 00: Prescaler off. 
+//  0 - 0: Disable external clock mode 2. 
+// 1 - 1: Invert ETR, low or falling edge active; 
+
+// Timing constant calculation: see setTimer1Gap()
+
+    TIM1->CTLR1 = 0x0004;    // URS=1 interupt on overload...
+    TIM1->SMCFGR = 0x8074;  // inverted trigger, no prescaler, no ETF, no MSM, Trigger Selection FS = external ETRF (7), SMS = reset mode (4)
+    setTimer1Gap();          // PSC, ATRLR, RPTCR for GapTime
+    TIM_Cmd( TIM1, ENABLE );
+
+    TIM_ClearITPendingBit( TIM1, TIM_IT_Update );   // clear potential interrupt flag from the past
+
+    NVIC_EnableIRQ(TIM1_UP_IRQn);                   // enable Timer 1 update unterrupt on controller
+
+    TIM_ITConfig(TIM1, TIM_IT_Update, ENABLE);      // enable timer updating event in timer config
+
+}
+
+void SUSI2::setTimer1Gap() {
+
+// Timer update is generated, when counter reach ATRLR (counter is reset by every falling edge of SUSI clock).
+// In reality prescaler starts with 0, it mean, we must increment it (+1) to be on usual mathematic:
+// ((PSC + 1) * ATRLR) / SystemCoreClock = gap
+// Ticks are calculated with 10 us step first (no overflow up to 650 MHz * 65 ms), then prescaler is the smallest one, which fits ATRLR to 16 bits.
+// For example 48 MHz and 7 ms: Ticks = 480 * 7000 / 10 = 336 000, PSC + 1 = 336 000 / 65 536 + 1 = 6, ATRLR = 56 000.
+// Repetition counter is not used (RPTCR = 0), then reset by clock edge restarts whole gap.
+
+    uint32_t Ticks = (SystemCoreClock / 100000) * GapTime / 10;   // timer clock (APB2 = HCLK) ticks per gap
+    uint32_t Prescaler = (Ticks >> 16) + 1;                       // ATRLR must be max 65535
+    TIM1->PSC = Prescaler - 1;
+    TIM1->ATRLR = Ticks / Prescaler;
+    TIM1->RPTCR = 0;
+    TIM1->SWEVGR = 0x0001;                                        // UG = load prescaler now (no interrupt as URS=1)
+}
+
+void SUSI2::initTimer2() {     // Timer 2 in one pulse mode, measure length of ACK pulse
+
+    AckStatus = SUSI_ACK_IDLE;  // no ACK yet
+
+#ifdef  TIM_MODULE_ENABLED
+    ackTimer.setOverflow(SUSI_ACK_LENGTH, MICROSEC_FORMAT);   // ACK pulse length                        This part is for HardwareTimer compatibility only
+    ackTimer.attachInterrupt(ackHandler);                     // release of data line in interrupt       This part is for HardwareTimer compatibility only
+#else
+    RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM2, ENABLE );   // enable clock for timer
+
+//R16_TIM2_CTLR1  Control register 1
+// 0000 0000 0000 1100 = 0x000C
+//                   0 - Enables the counter. -> this is enabled by SendACK
+//                  0 - 0: UEV is allowed.
+//                 1 - 1: Only counter overflow generates update interrupt (not UG bit below).
+//                1 - 1: One pulse mode - counter stops (CEN cleared) at next update event.
+
+    TIM2->CTLR1 = 0x000C;                           // URS=1, OPM=1
+    TIM2->PSC = (SystemCoreClock / 1000000) - 1;    // 1 MHz counting -> ATRLR is in microseconds
+    TIM2->ATRLR = SUSI_ACK_LENGTH;                  // ACK pulse length
+    TIM2->SWEVGR = 0x0001;                          // UG = load prescaler now (no interrupt as URS=1)
+
+    TIM_ClearITPendingBit( TIM2, TIM_IT_Update );   // clear potential interrupt flag from the past
+
+    NVIC_EnableIRQ(TIM2_IRQn);                      // enable Timer 2 update unterrupt on controller
+
+    TIM_ITConfig(TIM2, TIM_IT_Update, ENABLE);      // enable timer updating event in timer config
+#endif
+}
+
+/**********************************************************************************************************************/
+/* ACK pulse as hardware */
+// Pulse is started here and finished by Timer 2 interrupt, then process() is not blocked for 1.5 ms.
+void SUSI2::SendACK() {
+#ifdef  TIM_MODULE_ENABLED
+  ackTimer.pause();             // stop running pulse (if any), to not be released in the middle
+#else
+  TIM_Cmd( TIM2, DISABLE );     // stop running pulse (if any), to not be released in the middle
+#endif
+  AckStatus = SUSI_ACK_BUSY;
+  pinMode(SPI_MOSI,OUTPUT_OD);  // change pin to output, with open drain
+  digitalWrite(SPI_MOSI, LOW);  // set it to low
+#ifdef  TIM_MODULE_ENABLED
+  ackTimer.setCount(0);         // measure pulse from now
+  ackTimer.resume();
+#else
+  TIM2->CNT = 0;                // measure pulse from now
+  TIM_Cmd( TIM2, ENABLE );      // Timer 2 interrupt change pin back to input
+#endif
+}
+
+/**********************************************************************************************************************/
+/* Low power idle */
+// Sleep mode (WFI) keeps all clocks running, then wake-up is only few cycles plus interrupt entry (below 1 us at 48 MHz).
+// Byte is lost only, when it is not read from SPI before next one is shifted in (8 SUSI clocks, at minimum 80 us),
+// then sleeping between packets never loses byte. Worst case latency of packet to process() is one interrupt entry + framing.
+// Interrupts are disabled between check of queue and WFI: interrupt pending at WFI wakes the core immediately
+// and is served right after __enable_irq(), then packet completed in between is never left in queue until next wake-up.
+void SUSI2::waitForPacket() {
+  __disable_irq();
+#ifdef SUSI_USE_DMA
+  DrainDMA();                                  // tail of burst, which is in DMA buffer already
+#endif
+  if (Waiting() == 0) {
+    __WFI();
+  }
+  __enable_irq();
+}
+
+#ifdef SUSI_USE_DMA
+// DMA interrupt comes every SUSI_DMA_BUFFER_SIZE/2 bytes, then packets at the end of burst would wait for gap (7 ms).
+// process() frames them itself, interrupts are disabled meanwhile, because DMA and Timer1 interrupts frame the same buffer.
+void SUSI2::DrainReceiver(void) {
+  __disable_irq();
+  DrainDMA();
+  __enable_irq();
+}
+#endif
+
+SUSI_ACK_STATUS SUSI2::getAckStatus(void) {
+  return AckStatus;
+}
+
+/**********************************************************************************************************************/
+/* Flash primitives for SUSI2FlashCV */
+// Erase of page takes few ms and program of word ~ 100 us, CPU is stalled when it runs from the same flash.
+// Interrupts are served late then, bytes received meanwhile can be lost (packet is repeated by master).
+bool susiFlashErase(uint32_t Address) {
+  FLASH_Unlock();
+  FLASH_Status Status = FLASH_ErasePage(Address);
+  FLASH_Lock();
+  return Status == FLASH_COMPLETE;
+}
+
+bool susiFlashProgram(uint32_t Address, uint32_t Data) {
+  if (susiFlashRead(Address) != 0xFFFFFFFF) {return false;}                  // word is not erased (torn write in the past)
+  FLASH_Unlock();
+  FLASH_ProgramWord(Address, Data);
+  FLASH_Lock();
+  return susiFlashRead(Address) == Data;                                      // verify
+}
+
+uint32_t susiFlashRead(uint32_t Address) {
+  return *(volatile uint32_t*)Address;
+}